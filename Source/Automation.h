@@ -0,0 +1,116 @@
+#pragma once
+#include <atomic>
+#include "Utils.h"
+
+namespace automation
+{
+	// blocks in which a parameter moved are processed in chunks of this many samples
+	static constexpr int subBlockSize = 32;
+
+	// plain (denormalised) values of every parameter the processing chain reads
+	struct ParameterSnapshot
+	{
+		float lowCut = 20.f;
+		float highCut = 20'000.f;
+		float delayTime = 0.f;
+		float ratio = 1.f;
+		float threshold = -18.f;
+		float inputGain = 0.f;
+		float outputGain = 0.f;
+		float drive = 0.f;
+		int numTaps = 1;
+		bool isDirty = false;
+		bool isMultiband = false;
+
+		bool operator==(const ParameterSnapshot& other) const noexcept
+		{
+			return lowCut == other.lowCut
+				&& highCut == other.highCut
+				&& delayTime == other.delayTime
+				&& ratio == other.ratio
+				&& threshold == other.threshold
+				&& inputGain == other.inputGain
+				&& outputGain == other.outputGain
+				&& drive == other.drive
+				&& numTaps == other.numTaps
+				&& isDirty == other.isDirty
+				&& isMultiband == other.isMultiband;
+		}
+		bool operator!=(const ParameterSnapshot& other) const noexcept { return !(*this == other); }
+
+		/*
+		* linear ramp from start (position 0) to end (position 1)
+		* switches and counts jump straight to their end value so the whole ramp uses the new mode
+		*/
+		static ParameterSnapshot interpolate(const ParameterSnapshot& start, const ParameterSnapshot& end, float position) noexcept
+		{
+			auto lerp = [position](float a, float b) { return a + position * (b - a); };
+
+			ParameterSnapshot result;
+			result.lowCut = lerp(start.lowCut, end.lowCut);
+			result.highCut = lerp(start.highCut, end.highCut);
+			result.delayTime = lerp(start.delayTime, end.delayTime);
+			result.ratio = lerp(start.ratio, end.ratio);
+			result.threshold = lerp(start.threshold, end.threshold);
+			result.inputGain = lerp(start.inputGain, end.inputGain);
+			result.outputGain = lerp(start.outputGain, end.outputGain);
+			result.drive = lerp(start.drive, end.drive);
+			result.numTaps = end.numTaps;
+			result.isDirty = end.isDirty;
+			result.isMultiband = end.isMultiband;
+			return result;
+		}
+	};
+
+	/*
+	* caches the raw parameter atomics so the audio thread does not look them up by id every block
+	* change detection is done by comparing snapshots, which also catches the editor's macro
+	* writing straight into the raw values (those writes never reach parameter listeners)
+	*/
+	struct ParameterReader
+	{
+		ParameterReader(juce::AudioProcessorValueTreeState& params) :
+			lowCut(params.getRawParameterValue("LOWCUT")),
+			highCut(params.getRawParameterValue("HIGHCUT")),
+			delayTime(params.getRawParameterValue("DELAYTIME")),
+			ratio(params.getRawParameterValue("RATIO")),
+			threshold(params.getRawParameterValue("THRESHOLD")),
+			inputGain(params.getRawParameterValue("INPUTGAIN")),
+			outputGain(params.getRawParameterValue("OUTPUTGAIN")),
+			drive(params.getRawParameterValue("DRIVE")),
+			taps(params.getRawParameterValue("TAPS")),
+			dirtyMode(params.getRawParameterValue("DIRTYMODE")),
+			multiband(params.getRawParameterValue("MULTIBAND"))
+		{}
+
+		ParameterSnapshot read() const noexcept
+		{
+			ParameterSnapshot snapshot;
+			snapshot.lowCut = lowCut->load();
+			snapshot.highCut = highCut->load();
+			snapshot.delayTime = delayTime->load();
+			snapshot.ratio = ratio->load();
+			snapshot.threshold = threshold->load();
+			snapshot.inputGain = inputGain->load();
+			snapshot.outputGain = outputGain->load();
+			snapshot.drive = drive->load();
+			snapshot.numTaps = juce::roundToInt(taps->load());
+			snapshot.isDirty = static_cast<bool>(dirtyMode->load());
+			snapshot.isMultiband = static_cast<bool>(multiband->load());
+			return snapshot;
+		}
+
+	protected:
+		std::atomic<float>* lowCut;
+		std::atomic<float>* highCut;
+		std::atomic<float>* delayTime;
+		std::atomic<float>* ratio;
+		std::atomic<float>* threshold;
+		std::atomic<float>* inputGain;
+		std::atomic<float>* outputGain;
+		std::atomic<float>* drive;
+		std::atomic<float>* taps;
+		std::atomic<float>* dirtyMode;
+		std::atomic<float>* multiband;
+	};
+}
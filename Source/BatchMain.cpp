@@ -0,0 +1,119 @@
+/*
+  ==============================================================================
+
+    Command line entry point of the batch renderer.
+
+    UltiknobBatch <manifest.json> [--threads <n>] [--meter]
+
+    --meter adds the output peak, the deepest gain reduction and the
+    integrated loudness (before the output gain) of every file to the
+    report.
+
+    The manifest lists the files to render and the processor state to use:
+
+    {
+        "state": "preset.state",
+        "blockSize": 512,
+        "jobs": [
+            { "input": "stems/bass.wav", "output": "out/bass.wav" },
+            { "input": "stems/keys.wav", "output": "out/keys.wav", "state": "keys.state" }
+        ]
+    }
+
+    State files hold the bytes written by getStateInformation, relative
+    paths are resolved against the manifest's folder.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "BatchRenderer.h"
+#include <iostream>
+
+namespace
+{
+    juce::Result loadState(const juce::File& file, juce::MemoryBlock& state)
+    {
+        if (!file.existsAsFile() || !file.loadFileAsData(state))
+            return juce::Result::fail("cannot read state " + file.getFullPathName());
+        return juce::Result::ok();
+    }
+
+    juce::Result loadManifest(const juce::File& manifestFile, juce::Array<BatchJob>& jobs, int& blockSize)
+    {
+        const auto manifest = juce::JSON::parse(manifestFile);
+        if (!manifest.isObject())
+            return juce::Result::fail("cannot parse manifest " + manifestFile.getFullPathName());
+
+        const auto folder = manifestFile.getParentDirectory();
+
+        juce::MemoryBlock sharedState;
+        if (manifest.hasProperty("state"))
+        {
+            const auto result = loadState(folder.getChildFile(manifest["state"].toString()), sharedState);
+            if (result.failed())
+                return result;
+        }
+
+        if (manifest.hasProperty("blockSize"))
+            blockSize = static_cast<int>(manifest["blockSize"]);
+
+        const auto* entries = manifest["jobs"].getArray();
+        if (entries == nullptr)
+            return juce::Result::fail("manifest has no jobs array");
+
+        for (const auto& entry : *entries)
+        {
+            BatchJob job;
+            job.input = folder.getChildFile(entry["input"].toString());
+            job.output = folder.getChildFile(entry["output"].toString());
+            job.state = sharedState;
+
+            if (entry.hasProperty("state"))
+            {
+                const auto result = loadState(folder.getChildFile(entry["state"].toString()), job.state);
+                if (result.failed())
+                    return result;
+            }
+
+            jobs.add(std::move(job));
+        }
+
+        return juce::Result::ok();
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; // the parameter tree needs a message manager
+
+    juce::ArgumentList args(argc, argv);
+    if (args.size() < 1)
+    {
+        std::cout << "usage: UltiknobBatch <manifest.json> [--threads <n>] [--meter]" << std::endl;
+        return 1;
+    }
+
+    const auto manifestFile = args[0].resolveAsFile();
+    const auto numThreads = args.containsOption("--threads")
+        ? args.getValueForOption("--threads").getIntValue()
+        : juce::SystemStats::getNumCpus();
+
+    juce::Array<BatchJob> jobs;
+    int blockSize = 512;
+
+    const auto result = loadManifest(manifestFile, jobs, blockSize);
+    if (result.failed())
+    {
+        std::cout << result.getErrorMessage() << std::endl;
+        return 1;
+    }
+
+    BatchRenderer renderer(numThreads, blockSize);
+    renderer.setMetering(args.containsOption("--meter"));
+    const auto report = renderer.render(jobs);
+
+    std::cout << report.toString();
+    return report.numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,241 @@
+/*
+  ==============================================================================
+
+    Headless batch rendering: pushes a list of audio files through
+    UltiknobAudioProcessor on all cores.
+
+  ==============================================================================
+*/
+
+#include "BatchRenderer.h"
+#include <thread>
+
+//==============================================================================
+double BatchReport::getFilesPerSecond() const
+{
+    return wallSeconds > 0. ? numFiles / wallSeconds : 0.;
+}
+
+double BatchReport::getRealtimeFactorPerCore() const
+{
+    return busySeconds > 0. ? audioSeconds / busySeconds : 0.;
+}
+
+juce::String BatchReport::toString() const
+{
+    juce::String report;
+    report << "files:           " << numFiles << " (" << numFailed << " failed)" << juce::newLine
+           << "workers:         " << numWorkers << juce::newLine
+           << "wall time:       " << juce::String(wallSeconds, 2) << " s" << juce::newLine
+           << "audio rendered:  " << juce::String(audioSeconds, 2) << " s" << juce::newLine
+           << "throughput:      " << juce::String(getFilesPerSecond(), 2) << " files/s" << juce::newLine
+           << "realtime factor: " << juce::String(getRealtimeFactorPerCore(), 1) << "x per core" << juce::newLine;
+
+    for (auto& meter : meters)
+        report << "meter: " << meter << juce::newLine;
+
+    for (auto& error : errors)
+        report << "error: " << error << juce::newLine;
+
+    return report;
+}
+
+//==============================================================================
+WorkStealingPool::WorkStealingPool(int numWorkers)
+{
+    for (int worker = 0; worker < juce::jmax(1, numWorkers); ++worker)
+        queues.push_back(std::make_unique<Queue>());
+}
+
+void WorkStealingPool::run(int numJobs, const std::function<void(int, int)>& job)
+{
+    // deal the jobs out round robin, stealing evens out whatever that gets wrong
+    for (int index = 0; index < numJobs; ++index)
+        queues[static_cast<size_t>(index % getNumWorkers())]->jobs.push_back(index);
+
+    std::vector<std::thread> threads;
+    for (int worker = 0; worker < getNumWorkers(); ++worker)
+    {
+        threads.emplace_back([this, worker, &job]
+        {
+            int index;
+            while (pop(worker, index) || steal(worker, index))
+                job(worker, index);
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+}
+
+bool WorkStealingPool::pop(int worker, int& job)
+{
+    auto& queue = *queues[static_cast<size_t>(worker)];
+    std::lock_guard<std::mutex> guard(queue.lock);
+
+    if (queue.jobs.empty())
+        return false;
+
+    job = queue.jobs.back();
+    queue.jobs.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(int thief, int& job)
+{
+    // no jobs are added while running, so one empty sweep over all queues means everything is taken
+    for (int offset = 1; offset < getNumWorkers(); ++offset)
+    {
+        auto& queue = *queues[static_cast<size_t>((thief + offset) % getNumWorkers())];
+        std::lock_guard<std::mutex> guard(queue.lock);
+
+        if (!queue.jobs.empty())
+        {
+            job = queue.jobs.front();
+            queue.jobs.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+//==============================================================================
+BatchRenderer::BatchRenderer(int numWorkers, int _blockSize)
+    : pool(numWorkers),
+    blockSize(juce::jmax(1, _blockSize))
+{
+    formatManager.registerBasicFormats();
+
+    for (int worker = 0; worker < pool.getNumWorkers(); ++worker)
+    {
+        processors.push_back(std::make_unique<UltiknobAudioProcessor>());
+        processors.back()->setNonRealtime(true);
+    }
+
+    processors.front()->getStateInformation(defaultState);
+}
+
+BatchReport BatchRenderer::render(const juce::Array<BatchJob>& jobs)
+{
+    BatchReport report;
+    report.numFiles = jobs.size();
+    report.numWorkers = pool.getNumWorkers();
+
+    std::vector<double> busySeconds(static_cast<size_t>(pool.getNumWorkers()), 0.);
+    std::vector<double> audioSeconds(static_cast<size_t>(jobs.size()), 0.);
+    std::vector<juce::String> errors(static_cast<size_t>(jobs.size()));
+    std::vector<juce::String> meters(static_cast<size_t>(jobs.size()));
+
+    const auto startTime = juce::Time::getMillisecondCounterHiRes();
+
+    pool.run(jobs.size(), [&](int worker, int index)
+    {
+        const auto jobStartTime = juce::Time::getMillisecondCounterHiRes();
+
+        errors[static_cast<size_t>(index)] = renderJob(worker, jobs.getReference(index), audioSeconds[static_cast<size_t>(index)], meters[static_cast<size_t>(index)]);
+
+        busySeconds[static_cast<size_t>(worker)] += (juce::Time::getMillisecondCounterHiRes() - jobStartTime) * .001;
+    });
+
+    report.wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * .001;
+
+    // results are gathered per job index, so the report reads the same however jobs got scheduled
+    for (size_t index = 0; index < errors.size(); ++index)
+    {
+        report.audioSeconds += audioSeconds[index];
+        if (meters[index].isNotEmpty())
+            report.meters.add(meters[index]);
+        if (errors[index].isNotEmpty())
+        {
+            ++report.numFailed;
+            report.errors.add(errors[index]);
+        }
+    }
+    for (auto seconds : busySeconds)
+        report.busySeconds += seconds;
+
+    return report;
+}
+
+juce::String BatchRenderer::renderJob(int worker, const BatchJob& job, double& audioSeconds, juce::String& meter)
+{
+    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(job.input));
+    if (reader == nullptr)
+        return "cannot read " + job.input.getFullPathName();
+
+    const auto numFileChannels = static_cast<int>(reader->numChannels);
+    if (numFileChannels < 1 || numFileChannels > 2)
+        return "only mono and stereo files are supported: " + job.input.getFullPathName();
+
+    const auto sampleRate = reader->sampleRate;
+    const auto bitsPerSample = reader->usesFloatingPointData ? 32 : juce::jlimit(16, 24, static_cast<int>(reader->bitsPerSample));
+
+    job.output.getParentDirectory().createDirectory();
+    job.output.deleteFile();
+    std::unique_ptr<juce::FileOutputStream> stream(job.output.createOutputStream());
+    if (stream == nullptr)
+        return "cannot write " + job.output.getFullPathName();
+
+    juce::WavAudioFormat wav;
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(numFileChannels), bitsPerSample, {}, 0));
+    if (writer == nullptr)
+        return "cannot create a wav writer for " + job.output.getFullPathName();
+    stream.release(); // the writer owns the stream now
+
+    // every job starts from the same processor state, whichever worker renders it
+    auto& processor = *processors[static_cast<size_t>(worker)];
+    const auto& state = job.state.getSize() > 0 ? job.state : defaultState;
+    processor.setStateInformation(state.getData(), static_cast<int>(state.getSize()));
+    processor.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+    processor.prepareToPlay(sampleRate, blockSize);
+    processor.reset();
+    processor.setRandomSeed(job.input.getFileName().hashCode64());
+
+    // the processor always runs in stereo, mono files are duplicated and written back from the left channel
+    juce::AudioBuffer<float> buffer(2, blockSize);
+    juce::MidiBuffer midiMessages;
+
+    // the renderer is the only reader, so the telemetry is drained after every block
+    auto& telemetry = processor.getTelemetry();
+    telemetry::Frame frame;
+    auto outputPeak = 0.f, deepestReduction = 0.f, integratedLoudness = loudness::silence;
+    if (isMetering)
+        telemetry.connect();
+    else
+        telemetry.disconnect();
+
+    for (juce::int64 position = 0; position < reader->lengthInSamples; position += blockSize)
+    {
+        const auto numSamples = static_cast<int>(juce::jmin(static_cast<juce::int64>(blockSize), reader->lengthInSamples - position));
+        buffer.setSize(2, numSamples, false, false, true);
+
+        reader->read(&buffer, 0, numSamples, position, true, true);
+        if (numFileChannels == 1)
+            buffer.copyFrom(1, 0, buffer, 0, 0, numSamples);
+
+        processor.processBlock(buffer, midiMessages);
+
+        while (telemetry.read(frame))
+        {
+            outputPeak = juce::jmax(outputPeak, frame.outputPeak);
+            deepestReduction = juce::jmin(deepestReduction, frame.gainReduction);
+            integratedLoudness = frame.integratedLoudness;
+        }
+
+        if (!writer->writeFromAudioSampleBuffer(buffer, 0, numSamples))
+            return "failed writing " + job.output.getFullPathName();
+    }
+
+    processor.releaseResources();
+    audioSeconds = static_cast<double>(reader->lengthInSamples) / sampleRate;
+
+    if (isMetering)
+    {
+        telemetry.disconnect();
+        meter << job.input.getFileName()
+              << ": peak " << juce::String(juce::Decibels::gainToDecibels(outputPeak), 1) << " dBFS"
+              << ", gain reduction " << juce::String(deepestReduction, 1) << " dB"
+              << ", loudness " << juce::String(integratedLoudness, 1) << " LUFS before the output gain";
+    }
+    return {};
+}
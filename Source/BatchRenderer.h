@@ -0,0 +1,104 @@
+/*
+  ==============================================================================
+
+    Headless batch rendering: pushes a list of audio files through
+    UltiknobAudioProcessor on all cores.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//==============================================================================
+struct BatchJob
+{
+    juce::File input;
+    juce::File output;
+    juce::MemoryBlock state; // as written by UltiknobAudioProcessor::getStateInformation
+};
+
+struct BatchReport
+{
+    int numFiles{ 0 };
+    int numFailed{ 0 };
+    int numWorkers{ 0 };
+    double wallSeconds{ 0. };
+    double audioSeconds{ 0. };
+    double busySeconds{ 0. };   // summed over all workers
+    juce::StringArray errors;
+    juce::StringArray meters;   // one line per file, only when metering
+
+    double getFilesPerSecond() const;
+    double getRealtimeFactorPerCore() const;
+    juce::String toString() const;
+};
+
+//==============================================================================
+/**
+    Fixed set of worker threads, each with its own job deque.
+    A worker takes jobs from the back of its own deque and, once that is empty,
+    steals from the front of the others, so long files do not leave cores idle.
+*/
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(int numWorkers);
+
+    int getNumWorkers() const { return static_cast<int>(queues.size()); }
+
+    // calls job(workerIndex, jobIndex) once for every job and blocks until all are done
+    void run(int numJobs, const std::function<void(int, int)>& job);
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<int> jobs;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+
+    bool pop(int worker, int& job);
+    bool steal(int thief, int& job);
+
+    JUCE_DECLARE_NON_COPYABLE (WorkStealingPool)
+};
+
+//==============================================================================
+/**
+    Renders jobs with one processor instance per worker, reused between jobs.
+    Every job starts from a freshly reset processor with a seed derived from its
+    input file, so the output does not depend on which worker renders it or when.
+*/
+class BatchRenderer
+{
+public:
+    BatchRenderer(int numWorkers, int blockSize);
+
+    BatchReport render(const juce::Array<BatchJob>& jobs);
+
+    // reads the processors' telemetry and reports output peak, deepest gain reduction and integrated loudness per file
+    void setMetering(bool shouldMeter) { isMetering = shouldMeter; }
+
+private:
+    WorkStealingPool pool;
+    const int blockSize;
+    bool isMetering{ false };
+    juce::AudioFormatManager formatManager;
+    juce::MemoryBlock defaultState; // used for jobs without a state of their own
+
+    // returns an error message, empty on success
+    juce::String renderJob(int worker, const BatchJob& job, double& audioSeconds, juce::String& meter);
+
+    std::vector<std::unique_ptr<UltiknobAudioProcessor>> processors;
+
+    JUCE_DECLARE_NON_COPYABLE (BatchRenderer)
+};
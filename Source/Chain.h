@@ -0,0 +1,393 @@
+#pragma once
+#include "Delay.h"
+#include "Filters.h"
+#include "Saturator.h"
+#include "Compressor.h"
+#include "Automation.h"
+#include "Quality.h"
+#include "Parallel.h"
+#include "Telemetry.h"
+#include "Loudness.h"
+
+namespace dsp
+{
+	/*
+	* the complete ultiknob processing chain, independent of any plugin host
+	* used by the plugin processor and by the embeddable api
+	*/
+	struct Chain
+	{
+		static constexpr int maxChannels = 2;
+
+		// bufferLengthInMs should be at least 1 greater than the maximum slider value the user can set
+		// if slider is set to exactly the maximum buffersize, the delay has no effect
+		static constexpr double delayBufferLengthInMs = 51.;
+
+		// the delay modulation picks a new random delay time this often
+		static constexpr double modulationPeriodInSecs = 2.;
+
+		// below this the threads would spend more time handing the block over than processing it
+		static constexpr int minimumParallelBlockSize = 2'048;
+
+		// scratch buffers are never prepared for less, so the usual host block sizes never reallocate
+		static constexpr int reservedBlockSize = 4'096;
+
+		Chain() :
+			delay(),
+			cutFilters(),
+			saturator(),
+			compressor(),
+			random(),
+			samplesUntilModulation(0),
+			modulationPeriod(1),
+			maxBlockSize(0),
+			sampleRate(0.),
+			lastSnapshot(),
+			channelWorkers(),
+			channelBarrier(maxChannels),
+			isUsingChannelWorkers(false),
+			telemetry(),
+			loudnessMeter(),
+			isMeteringLoudness(false),
+			isMeasuringLoudness(false),
+			autoGain(0.f)
+		{}
+
+		/*
+		* hosts prepare again on every transport, bus or render change, mostly at the same sample rate
+		* buffers hold maxChannels and at least reservedBlockSize samples, longer blocks are split,
+		* so a new block size or channel layout keeps every buffer, delay line and gain ramp as it is
+		* only a new sample rate rebuilds the stages and clears them
+		*/
+		void prepare(double _sampleRate, int blockSize, const automation::ParameterSnapshot& snapshot)
+		{
+			if (_sampleRate == sampleRate)
+				return;
+
+			maxBlockSize = juce::jmax(maxBlockSize, blockSize, reservedBlockSize);
+			modulationPeriod = juce::jmax(1, juce::roundToInt(_sampleRate * modulationPeriodInSecs));
+
+			cutFilters.prepare(_sampleRate, maxBlockSize);
+			delay.prepare(_sampleRate, maxBlockSize, delayBufferLengthInMs);
+			saturator.prepare(_sampleRate, maxBlockSize);
+			compressor.prepare(_sampleRate, maxBlockSize);
+			loudnessMeter.prepare(_sampleRate);
+
+			// only set once every stage is rebuilt, a prepare that threw is repeated in full
+			sampleRate = _sampleRate;
+
+			// start from the current values so the first block does not ramp in from the defaults
+			reset(snapshot);
+		}
+
+		/*
+		* clears every delay line, filter and detector and ends running crossfades
+		* gains jump straight to the current parameters, so a reset chain always starts out the same
+		*/
+		void reset(const automation::ParameterSnapshot& snapshot)
+		{
+			lastSnapshot = snapshot;
+			reset();
+		}
+
+		void reset()
+		{
+			// the auto gain belongs to what was measured before, it starts over with the meter
+			autoGain = 0.f;
+			updateParameters(lastSnapshot);
+
+			cutFilters.reset();
+			delay.reset();
+			saturator.reset();
+			compressor.reset();
+			loudnessMeter.reset();
+			samplesUntilModulation = modulationPeriod;
+		}
+
+		void setQuality(quality::Tier tier)
+		{
+			const auto settings = quality::settingsForTier(tier);
+
+			delay.setInterpolation(settings.interpolation);
+			cutFilters.setTopology(settings.filterTopology);
+			compressor.setOversampling(settings.oversampledCompressor);
+			saturator.setAntialiasing(settings.antialiasedSaturation);
+		}
+
+		void setRandomSeed(juce::int64 seed)
+		{
+			random.setSeed(seed);
+		}
+
+		/*
+		* offline only: starts (or stops) a helper thread so the two channels of large blocks run side by side
+		* call from prepare, never from the audio thread
+		*/
+		void prepareChannelWorkers(bool shouldRun)
+		{
+			if (shouldRun && !channelWorkers.isRunning())
+				channelWorkers.start(maxChannels - 1);
+			else if (!shouldRun)
+				channelWorkers.stop();
+		}
+
+		void useChannelWorkers(bool shouldUse) noexcept
+		{
+			isUsingChannelWorkers = shouldUse;
+		}
+
+		/*
+		* loudness of the chain's output before OUTPUTGAIN and the auto gain, so it can drive the auto gain without feeding back on itself
+		* measured while enabled or while a telemetry reader is connected, read it from the audio thread or from the telemetry frames
+		*/
+		void setLoudnessMetering(bool shouldMeter) noexcept
+		{
+			isMeteringLoudness = shouldMeter;
+		}
+
+		/*
+		* extra output gain in dB on top of OUTPUTGAIN, ramped together with it
+		* it never shows up in the parameters or the snapshot, so changing it does not count as automation
+		* reset sets it back to 0
+		*/
+		void setAutoGain(float gainInDb) noexcept
+		{
+			autoGain = gainInDb;
+		}
+
+		void resetLoudness() noexcept
+		{
+			loudnessMeter.reset();
+		}
+
+		const loudness::Meter& getLoudness() const noexcept
+		{
+			return loudnessMeter;
+		}
+
+		// meters for the editor and command line tools, see telemetry::Channel
+		telemetry::Channel& getTelemetry() noexcept
+		{
+			return telemetry;
+		}
+
+		void processBlock(float** samples, int numChannels, int numSamples, const automation::ParameterSnapshot& snapshot)
+		{
+			// Telemetry
+			// nothing is measured unless a reader is connected
+			const auto isMetering = telemetry.isConnected();
+			telemetry::Frame frame;
+			if (isMetering)
+			{
+				const auto input = telemetry::measure(samples, numChannels, numSamples);
+				frame.inputPeak = input.peak;
+				frame.inputRms = input.rms;
+			}
+			compressor.startMetering(isMetering);
+			isMeasuringLoudness = isMeteringLoudness || isMetering;
+
+			processAutomation(samples, numChannels, numSamples, snapshot);
+
+			if (isMetering)
+			{
+				const auto output = telemetry::measure(samples, numChannels, numSamples);
+				frame.outputPeak = output.peak;
+				frame.outputRms = output.rms;
+				frame.gainReduction = compressor.getGainReduction();
+				frame.delayTime = delay.getDelayTimeInMs();
+				frame.momentaryLoudness = loudnessMeter.getMomentary();
+				frame.shortTermLoudness = loudnessMeter.getShortTerm();
+				frame.integratedLoudness = loudnessMeter.getIntegrated();
+				telemetry.publish(frame);
+			}
+		}
+
+	protected:
+		Delay delay;
+		CutFilters cutFilters;
+		Saturator saturator;
+		Compressor compressor;
+		juce::Random random;
+		int samplesUntilModulation, modulationPeriod;
+		int maxBlockSize;
+		double sampleRate;
+		automation::ParameterSnapshot lastSnapshot;
+		parallel::ChannelWorkers channelWorkers;
+		parallel::SpinBarrier channelBarrier;
+		bool isUsingChannelWorkers;
+		telemetry::Channel telemetry;
+		loudness::Meter loudnessMeter;
+		bool isMeteringLoudness, isMeasuringLoudness;
+		float autoGain;
+
+		void updateParameters(const automation::ParameterSnapshot& snapshot)
+		{
+			cutFilters.updateParameters(
+				snapshot.lowCut,
+				snapshot.highCut
+			);
+
+			saturator.updateParameters(snapshot.drive);
+
+			delay.setNumTaps(snapshot.numTaps);
+
+			compressor.setMultiband(snapshot.isMultiband);
+			if (snapshot.isDirty) {
+				compressor.updateParameters(
+					snapshot.ratio,
+					snapshot.threshold,
+					5.f,    // ATTACK
+					20.f,   // RELEASE
+					snapshot.inputGain,
+					snapshot.outputGain + autoGain
+				);
+			}
+			else
+			{
+				compressor.updateParameters(
+					snapshot.ratio,
+					snapshot.threshold,
+					20.f,   // ATTACK
+					100.f,  // RELEASE
+					snapshot.inputGain,
+					snapshot.outputGain + autoGain
+				);
+			}
+		}
+
+		/*
+		* the block is cut wherever something happens at a fixed sample position: a new random delay time,
+		* and with parameter changes every sub-block boundary, so the result does not depend on the host's block size
+		* blocks larger than the prepared size are split as well
+		*/
+		void processAutomation(float** samples, int numChannels, int numSamples, const automation::ParameterSnapshot& snapshot)
+		{
+			// Automation
+			// without parameter changes the block goes through the chain in as few pieces as possible,
+			// otherwise every sub-block gets its share of the ramp
+			const auto isAutomated = snapshot != lastSnapshot;
+			const auto maxLength = isAutomated ? automation::subBlockSize : maxBlockSize;
+
+			for (auto start = 0; start < numSamples;)
+			{
+				const auto length = juce::jmin(maxLength, numSamples - start, samplesUntilModulation);
+				const auto position = static_cast<float>(start + length) / static_cast<float>(numSamples);
+				const auto subSnapshot = isAutomated ? automation::ParameterSnapshot::interpolate(lastSnapshot, snapshot, position) : snapshot;
+
+				float* subBlock[maxChannels]{ nullptr, nullptr };
+				for (auto channel = 0; channel < numChannels; ++channel)
+					subBlock[channel] = samples[channel] + start;
+
+				processSubBlock(subBlock, numChannels, length, subSnapshot);
+
+				// Loudness
+				if (isMeasuringLoudness)
+					loudnessMeter.process(subBlock, numChannels, length, compressor.getOutputGains());
+
+				// Speed fluctiation
+				samplesUntilModulation -= length;
+				if (samplesUntilModulation == 0)
+				{
+					delay.updateParameters(random.nextFloat() * subSnapshot.delayTime); // nextFloat() returns float between 0. and 1. so scale to linearly to between 0. and 40.
+					samplesUntilModulation = modulationPeriod;
+				}
+
+				start += length;
+			}
+			lastSnapshot = snapshot;
+		}
+
+		void processSubBlock(float** samples, int numChannels, int numSamples, const automation::ParameterSnapshot& snapshot)
+		{
+			if (isUsingChannelWorkers
+				&& channelWorkers.isRunning()
+				&& numChannels == maxChannels
+				&& numSamples >= minimumParallelBlockSize)
+				return processSubBlockInParallel(samples, numChannels, numSamples, snapshot);
+
+			updateParameters(snapshot);
+
+			// Filtering
+			cutFilters.processBlock(
+				juce::dsp::AudioBlock<float>(samples, static_cast<size_t>(numChannels), static_cast<size_t>(numSamples)),
+				numChannels,
+				numSamples,
+				sampleRate
+			);
+
+			// Speed fluctiation
+			delay.processBlock(
+				samples,
+				numChannels,
+				numSamples
+			);
+
+			// Saturation
+			if (snapshot.isDirty)
+			{
+				saturator.processBlock(
+					samples,
+					numChannels,
+					numSamples
+				);
+			}
+			else
+			{
+				saturator.bypass();
+			}
+
+			// Compression
+			compressor.processBlock(
+				samples,
+				numChannels,
+				numSamples
+			);
+		}
+
+		/*
+		* same chain as processSubBlock, but every channel runs on its own thread
+		* everything the channels share is advanced once up front, the stereo linked multiband core
+		* is the only step that needs both channels, so there the threads meet and channel 0 runs it
+		*/
+		void processSubBlockInParallel(float** samples, int numChannels, int numSamples, const automation::ParameterSnapshot& snapshot)
+		{
+			updateParameters(snapshot);
+
+			cutFilters.prepareBlock(numSamples, sampleRate);
+			delay.prepareBlock(numSamples);
+			if (snapshot.isDirty)
+				saturator.prepareBlock(numSamples);
+			else
+				saturator.bypass();
+			compressor.prepareBlock(numSamples);
+
+			const auto isStereoLinked = compressor.isStereoLinked();
+
+			auto processChannel = [&](int channel)
+			{
+				auto channelSamples = samples[channel];
+
+				cutFilters.processChannel(channel, channelSamples, numSamples);
+				delay.processChannel(channel, channelSamples, numSamples);
+				if (snapshot.isDirty)
+					saturator.processChannel(channel, channelSamples, numSamples);
+
+				compressor.processInput(channelSamples, numSamples);
+				if (isStereoLinked)
+				{
+					channelBarrier.arriveAndWait();
+					if (channel == 0)
+						compressor.processLinkedCore(samples, numChannels, numSamples);
+					channelBarrier.arriveAndWait();
+				}
+				else
+				{
+					compressor.processCoreChannel(channel, channelSamples, numSamples);
+				}
+				compressor.processOutput(channelSamples, numSamples);
+			};
+
+			channelWorkers.run(processChannel);
+		}
+	};
+}
@@ -1,39 +1,195 @@
 #pragma once
+#include <array>
+#include <memory>
+#include <vector>
+#include "Quality.h"
+#include "Multiband.h"
+#include "FastMath.h"
 
 namespace dsp {
+	/*
+	* feed-forward peak compressor with the ballistics and gain computer of juce::dsp::Compressor
+	* the detector has to run sample by sample, the gain computer then runs over the whole block
+	* in the log domain: gain = 2^((1 / ratio - 1) * log2(max(envelope / threshold, 1)))
+	*/
+	struct PeakCompressor
+	{
+		static constexpr int maxChannels = 2;
+
+		PeakCompressor() :
+			sampleRate(44100.),
+			thresholdInverse(1.f),
+			ratioExponent(0.f),
+			attackCte(0.f),
+			releaseCte(0.f),
+			envelope(),
+			levels()
+		{}
+
+		void prepare(double _sampleRate, int blockSize)
+		{
+			sampleRate = _sampleRate;
+			for (auto& level : levels)
+				level.resize(blockSize);
+			reset();
+		}
+
+		void reset() noexcept
+		{
+			envelope.fill(0.f);
+		}
+
+		void updateParameters(float ratio, float threshold, float attack, float release) noexcept
+		{
+			thresholdInverse = fastmath::decibelsToGain(-threshold);
+			ratioExponent = 1.f / ratio - 1.f;
+			attackCte = ballisticsCoefficient(attack);
+			releaseCte = ballisticsCoefficient(release);
+		}
+
+		// channels only touch their own envelope and scratch buffer, so they can run on different threads
+		void processChannel(int channel, float* samplesSingleChannel, int numSamples) noexcept
+		{
+			auto level = levels[channel].data();
+
+			auto channelEnvelope = envelope[channel];
+			for (auto sample = 0; sample < numSamples; ++sample)
+			{
+				const auto input = std::abs(samplesSingleChannel[sample]);
+				const auto cte = input > channelEnvelope ? attackCte : releaseCte;
+				channelEnvelope = input + cte * (channelEnvelope - input);
+				level[sample] = channelEnvelope * thresholdInverse;
+			}
+			envelope[channel] = channelEnvelope;
+
+			// overshoot above the threshold, 1 below it, so the gain there is 2^0
+			juce::FloatVectorOperations::max(level, level, 1.f, numSamples);
+			fastmath::log2(level, level, numSamples);
+			juce::FloatVectorOperations::multiply(level, ratioExponent, numSamples);
+			fastmath::exp2(level, level, numSamples);
+			juce::FloatVectorOperations::multiply(samplesSingleChannel, level, numSamples);
+		}
+
+	protected:
+		double sampleRate;
+		float thresholdInverse, ratioExponent, attackCte, releaseCte;
+		std::array<float, maxChannels> envelope;
+		std::array<std::vector<float>, maxChannels> levels;
+
+		float ballisticsCoefficient(float timeInMs) const noexcept
+		{
+			return timeInMs < 1.e-3f
+				? 0.f
+				: static_cast<float>(std::exp(-2. * juce::MathConstants<double>::pi * 1000. / (timeInMs * sampleRate)));
+		}
+	};
+
 	struct Compressor
 	{
+		static constexpr int maxChannels = 2;
+
+		enum class Core
+		{
+			SingleBand,
+			Oversampled,
+			Multiband
+		};
+
 		Compressor() :
 			compressor(),
+			oversampledCompressor(),
+			oversampling(),
+			multibandCompressor(),
+			inputGain(),
+			outputGain(),
 			ratio(1.f),
 			threshold(0.f),
 			attack(20.f),
 			release(100.f),
-			inputGain(),
-			outputGain()
+			isOversampled(false),
+			isMultiband(false),
+			core(Core::SingleBand),
+			previousCore(Core::SingleBand),
+			crossfade(),
+			crossfadeGains(),
+			crossfadeBuffer(),
+			inputGains(),
+			outputGains(),
+			isFading(false),
+			isMetering(false),
+			coreInputEnergy(),
+			coreOutputEnergy()
 		{}
 
-		void prepare(double sampleRate, int blockSize, int numChannels)
+		void prepare(double sampleRate, int blockSize)
 		{
 			juce::dsp::ProcessSpec spec;
 			spec.maximumBlockSize = blockSize;
-			spec.numChannels = numChannels;
+			spec.numChannels = maxChannels;
 			spec.sampleRate = sampleRate;
 
-			compressor.prepare(spec);
-			compressor.setRatio(ratio);
-			compressor.setThreshold(threshold);
-			compressor.setAttack(attack);
-			compressor.setRelease(release);
+			compressor.prepare(sampleRate, blockSize);
+			compressor.updateParameters(ratio, threshold, attack, release);
 
+			inputGain.prepare(spec);
+			outputGain.prepare(spec);
 			inputGain.setRampDurationSeconds(0.5);
 			outputGain.setRampDurationSeconds(0.5);
+			inputGains.resize(blockSize);
+			outputGains.resize(blockSize);
+
+			// both paths are always prepared, so switching tier never allocates on the audio thread
+			// one mono oversampler per channel keeps the channels independent of each other
+			// the half band filters do not depend on the sample rate, so they are only built once
+			for (auto& channelOversampling : oversampling)
+			{
+				if (channelOversampling == nullptr)
+					channelOversampling = std::make_unique<juce::dsp::Oversampling<float>>(
+						1,
+						1,
+						juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR);
+				channelOversampling->initProcessing(static_cast<size_t>(blockSize));
+			}
+
+			oversampledCompressor.prepare(sampleRate * 2., blockSize * 2);
+
+			multibandCompressor.prepare(sampleRate, blockSize);
+
+			crossfade.prepare(static_cast<int>(sampleRate * .02));
+			crossfadeGains.resize(blockSize);
+			crossfadeBuffer.setSize(maxChannels, blockSize, false, false, true);
+		}
+
+		// hosts may reset before the first prepare, the oversamplers only exist from then on
+		void reset()
+		{
+			compressor.reset();
+			for (auto& channelOversampling : oversampling)
+				if (channelOversampling != nullptr)
+					channelOversampling->reset();
+			oversampledCompressor.reset();
+			multibandCompressor.reset();
+			inputGain.reset();
+			outputGain.reset();
+			crossfade.finish();
+		}
+
+		void setOversampling(bool _isOversampled) noexcept
+		{
+			isOversampled = _isOversampled;
+			switchCore();
+		}
+
+		void setMultiband(bool _isMultiband) noexcept
+		{
+			isMultiband = _isMultiband;
+			switchCore();
 		}
 
 		void updateParameters(
-			float _ratio, 
-			float _threshold, 
-			float _attack, 
+			float _ratio,
+			float _threshold,
+			float _attack,
 			float _release,
 			float _inputGain,
 			float _outputGain)
@@ -42,39 +198,226 @@ namespace dsp {
 			threshold = _threshold;
 			attack = _attack;
 			release = _release;
-			inputGain.setGainDecibels(_inputGain);
-			outputGain.setGainDecibels(_outputGain);
+			inputGain.setGainLinear(fastmath::decibelsToGain(_inputGain));
+			outputGain.setGainLinear(fastmath::decibelsToGain(_outputGain));
 		}
 
 		void processBlock(float** samples, int numChannels, int numSamples)
 		{
-			compressor.setRatio(ratio);
-			compressor.setThreshold(threshold);
-			compressor.setAttack(attack);
-			compressor.setRelease(release);
+			prepareBlock(numSamples);
 
 			for (auto channel = 0; channel < numChannels; ++channel)
+				processInput(samples[channel], numSamples);
+
+			if (isStereoLinked())
+			{
+				processLinkedCore(samples, numChannels, numSamples);
+			}
+			else
 			{
-				auto samplesSingleChannel = samples[channel];
+				for (auto channel = 0; channel < numChannels; ++channel)
+					processCoreChannel(channel, samples[channel], numSamples);
+			}
+
+			for (auto channel = 0; channel < numChannels; ++channel)
+				processOutput(samples[channel], numSamples);
+		}
 
-				for (auto sample = 0; sample < numSamples; ++sample)
-				{
-					float input = inputGain.processSample(samplesSingleChannel[sample]);
+		/*
+		* the steps of processBlock, for running the channels on different threads:
+		* prepareBlock once, then processInput and processCoreChannel per channel
+		* a stereo linked core instead needs processLinkedCore once, after every channel's input is done
+		* processOutput per channel comes last
+		*/
+		void prepareBlock(int numSamples)
+		{
+			compressor.updateParameters(ratio, threshold, attack, release);
+			oversampledCompressor.updateParameters(ratio, threshold, attack, release);
 
-					float output = compressor.processSample(channel, input);
+			multibandCompressor.updateParameters(ratio, threshold, attack, release);
 
-					samplesSingleChannel[sample] = outputGain.processSample(output);
-				}
+			// the gain ramps are rendered once, so every channel follows the same ramp
+			for (auto sample = 0; sample < numSamples; ++sample)
+			{
+				inputGains[sample] = inputGain.processSample(1.f);
+				outputGains[sample] = outputGain.processSample(1.f);
 			}
+
+			isFading = crossfade.isActive();
+			if (isFading)
+				crossfade(crossfadeGains.data(), numSamples);
+		}
+
+		// the output gain of every sample in the last block, including its ramp
+		const float* getOutputGains() const noexcept
+		{
+			return outputGains.data();
+		}
+
+		bool isStereoLinked() const noexcept
+		{
+			return core == Core::Multiband || (isFading && previousCore == Core::Multiband);
+		}
+
+		void processInput(float* samplesSingleChannel, int numSamples) const noexcept
+		{
+			juce::FloatVectorOperations::multiply(samplesSingleChannel, inputGains.data(), numSamples);
+		}
+
+		void processOutput(float* samplesSingleChannel, int numSamples) const noexcept
+		{
+			juce::FloatVectorOperations::multiply(samplesSingleChannel, outputGains.data(), numSamples);
+		}
+
+		void processCoreChannel(int channel, float* samplesSingleChannel, int numSamples)
+		{
+			if (isMetering)
+				coreInputEnergy[channel] += utils::sumOfSquares(samplesSingleChannel, numSamples);
+
+			if (isFading)
+			{
+				// while switching, both paths compress the same input and are crossfaded
+				auto previousSamples = crossfadeBuffer.getWritePointer(channel);
+				juce::FloatVectorOperations::copy(previousSamples, samplesSingleChannel, numSamples);
+
+				processCore(previousCore, channel, previousSamples, numSamples);
+				processCore(core, channel, samplesSingleChannel, numSamples);
+
+				utils::Crossfade::mix(samplesSingleChannel, previousSamples, crossfadeGains.data(), numSamples);
+			}
+			else
+			{
+				processCore(core, channel, samplesSingleChannel, numSamples);
+			}
+
+			if (isMetering)
+				coreOutputEnergy[channel] += utils::sumOfSquares(samplesSingleChannel, numSamples);
+		}
+
+		void processLinkedCore(float** samples, int numChannels, int numSamples)
+		{
+			if (isMetering)
+				for (auto channel = 0; channel < numChannels; ++channel)
+					coreInputEnergy[channel] += utils::sumOfSquares(samples[channel], numSamples);
+
+			if (isFading)
+			{
+				for (auto channel = 0; channel < numChannels; ++channel)
+					crossfadeBuffer.copyFrom(channel, 0, samples[channel], numSamples);
+
+				auto previousSamples = crossfadeBuffer.getArrayOfWritePointers();
+				processLinked(previousCore, previousSamples, numChannels, numSamples);
+				processLinked(core, samples, numChannels, numSamples);
+
+				for (auto channel = 0; channel < numChannels; ++channel)
+					utils::Crossfade::mix(samples[channel], previousSamples[channel], crossfadeGains.data(), numSamples);
+			}
+			else
+			{
+				processLinked(core, samples, numChannels, numSamples);
+			}
+
+			if (isMetering)
+				for (auto channel = 0; channel < numChannels; ++channel)
+					coreOutputEnergy[channel] += utils::sumOfSquares(samples[channel], numSamples);
+		}
+
+		/*
+		* gain reduction is measured as the energy the core takes away, accumulated from here on
+		* call once per block, without metering the core is not measured at all
+		*/
+		void startMetering(bool shouldMeter) noexcept
+		{
+			isMetering = shouldMeter;
+			coreInputEnergy.fill(0.f);
+			coreOutputEnergy.fill(0.f);
+		}
+
+		// in dB, 0 or negative
+		float getGainReduction() const noexcept
+		{
+			auto input = 0.f, output = 0.f;
+			for (auto channel = 0; channel < maxChannels; ++channel)
+			{
+				input += coreInputEnergy[channel];
+				output += coreOutputEnergy[channel];
+			}
+
+			if (input <= 0.f)
+				return 0.f;
+			return juce::jmin(0.f, juce::Decibels::gainToDecibels(output / input) * .5f);
 		}
 
 	protected:
-		juce::dsp::Compressor<float> compressor;
+		PeakCompressor compressor;
+		PeakCompressor oversampledCompressor;
+		std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, maxChannels> oversampling;
+		MultibandCompressor multibandCompressor;
 		juce::dsp::Gain<float> inputGain;
 		juce::dsp::Gain<float> outputGain;
 		float ratio;
 		float threshold;
 		float attack;
 		float release;
+		bool isOversampled, isMultiband;
+		Core core, previousCore;
+		utils::Crossfade crossfade;
+		std::vector<float> crossfadeGains;
+		juce::AudioBuffer<float> crossfadeBuffer;
+		std::vector<float> inputGains, outputGains;
+		bool isFading;
+		bool isMetering;
+		std::array<float, maxChannels> coreInputEnergy, coreOutputEnergy;
+
+		// the multiband mode replaces the single band compressor at every quality tier
+		void switchCore() noexcept
+		{
+			const auto nextCore = isMultiband ? Core::Multiband : isOversampled ? Core::Oversampled : Core::SingleBand;
+			if (nextCore == core)
+				return;
+
+			previousCore = core;
+			core = nextCore;
+
+			switch (core)
+			{
+			case Core::SingleBand:
+				compressor.reset();
+				break;
+			case Core::Oversampled:
+				for (auto& channelOversampling : oversampling)
+					if (channelOversampling != nullptr)
+						channelOversampling->reset();
+				oversampledCompressor.reset();
+				break;
+			case Core::Multiband:
+				multibandCompressor.reset();
+				break;
+			}
+			crossfade.start();
+		}
+
+		void processLinked(Core type, float** samples, int numChannels, int numSamples)
+		{
+			if (type == Core::Multiband)
+				return multibandCompressor.processBlock(samples, numChannels, numSamples);
+
+			for (auto channel = 0; channel < numChannels; ++channel)
+				processCore(type, channel, samples[channel], numSamples);
+		}
+
+		void processCore(Core type, int channel, float* samplesSingleChannel, int numSamples)
+		{
+			jassert(type != Core::Multiband); // stereo linked, only runs through processLinked
+
+			if (type == Core::SingleBand)
+				return compressor.processChannel(channel, samplesSingleChannel, numSamples);
+
+			juce::dsp::AudioBlock<float> block(&samplesSingleChannel, 1, static_cast<size_t>(numSamples));
+			auto oversampledBlock = oversampling[channel]->processSamplesUp(block);
+			oversampledCompressor.processChannel(channel, oversampledBlock.getChannelPointer(0), static_cast<int>(oversampledBlock.getNumSamples()));
+
+			oversampling[channel]->processSamplesDown(block);
+		}
 	};
-}
\ No newline at end of file
+}
@@ -1,7 +1,9 @@
 #pragma once
+#include <algorithm>
 #include <array>
 #include <vector>
 #include "Utils.h"
+#include "Quality.h"
 
 namespace dsp
 {
@@ -40,6 +42,11 @@ namespace dsp
 			}
 		}
 
+		void reset() noexcept
+		{
+			writeHeadIndex = 0;
+		}
+
 		int operator[](int i) const noexcept { return writeHeadBuffer[i]; }
 
 	protected:
@@ -48,8 +55,20 @@ namespace dsp
 		int ringBufferSize;
 	};
 
+	/*
+	* the speed fluctuation delay, optionally as an ensemble:
+	* tap 0 follows the random delay time alone, every extra tap adds a slow sine modulation with its own phase on top
+	* all taps read from the same ring buffer in one pass, so extra voices cost reads only
+	*/
 	struct Delay
 	{
+		static constexpr int maxTaps = 4;
+		static constexpr double ensembleRateInHz = .5;
+		static constexpr double ensembleDepthInMs = 2.;
+
+		// ring buffers are reserved for this rate up front, moving between the common rates never reallocates
+		static constexpr double reservedSampleRate = 192'000.;
+
 		Delay() :
 			sampleRate(0.),
 			ringBuffer(),
@@ -57,22 +76,89 @@ namespace dsp
 			delayTimeSmooth(0.f),
 			writeHead(),
 			delayLength(0.f),
-			ringBufferSize(51)
-		{}
+			currentDelayLength(0.f),
+			ringBufferSize(51),
+			interpolation(quality::Interpolation::Linear),
+			previousInterpolation(quality::Interpolation::Linear),
+			crossfade(),
+			crossfadeGains(),
+			isFading(false),
+			numTaps(1),
+			activeTaps(1),
+			tapGains(),
+			tapGainSteps(),
+			tapOffsets(),
+			ensembleDepth(0.f),
+			ensemblePhase(0.),
+			ensembleIncrement(0.),
+			previousBlockLength(0)
+		{
+			tapGains.fill(0.f);
+			tapGains[0] = 1.f;
+			tapGainSteps.fill(0.f);
+		}
 
 		void prepare(double _sampleRate, int blockSize, double bufferLengthInMs)
 		{
 			sampleRate = _sampleRate;
 
 			const auto lengthInSamples = static_cast<int>(msToSamples(_sampleRate, bufferLengthInMs));
+			const auto reservedLength = static_cast<int>(msToSamples(juce::jmax(_sampleRate, reservedSampleRate), bufferLengthInMs));
 			for (auto& channel : ringBuffer)
+			{
+				channel.reserve(static_cast<size_t>(reservedLength));
 				channel.resize(lengthInSamples, 0.f);
+			}
 
 			ringBufferSize = lengthInSamples;
 
 			writeHead.prepare(blockSize, ringBufferSize);
 			parameterBufferLength.resize(blockSize);
 			utils::Smooth::makeFromDecayInSecs(delayTimeSmooth, 5.f, sampleRate);
+
+			crossfade.prepare(static_cast<int>(msToSamples(_sampleRate, 20.)));
+			crossfadeGains.resize(blockSize);
+
+			for (auto& offsets : tapOffsets)
+				offsets.resize(blockSize);
+			ensembleDepth = static_cast<float>(msToSamples(_sampleRate, ensembleDepthInMs));
+			ensembleIncrement = 2. * juce::MathConstants<double>::pi * ensembleRateInHz / _sampleRate;
+		}
+
+		void reset() noexcept
+		{
+			for (auto& channel : ringBuffer)
+				std::fill(channel.begin(), channel.end(), 0.f);
+
+			std::fill(parameterBufferLength.begin(), parameterBufferLength.end(), 0.f);
+			delayTimeSmooth.setCurrentValue(0.f);
+			delayLength = 0.f;
+			currentDelayLength = 0.f;
+			writeHead.reset();
+			crossfade.finish();
+
+			for (auto tap = 0; tap < maxTaps; ++tap)
+				tapGains[tap] = targetGain(tap);
+			tapGainSteps.fill(0.f);
+			activeTaps = numTaps;
+			ensemblePhase = 0.;
+			previousBlockLength = 0;
+		}
+
+		// 1 is the plain delay, the gain of the taps is ramped over the next block
+		void setNumTaps(int _numTaps) noexcept
+		{
+			numTaps = juce::jlimit(1, maxTaps, _numTaps);
+		}
+
+		void setInterpolation(quality::Interpolation _interpolation) noexcept
+		{
+			if (_interpolation == interpolation)
+				return;
+
+			previousInterpolation = interpolation;
+			interpolation = _interpolation;
+			crossfade.start();
 		}
 
 		void updateParameters(float _delayLength)
@@ -81,46 +167,163 @@ namespace dsp
 		}
 
 		void processBlock(float** samples, int numChannels, int numSamples)
+		{
+			prepareBlock(numSamples);
+
+			for (auto channel = 0; channel < numChannels; ++channel)
+				processChannel(channel, samples[channel], numSamples);
+		}
+
+		// advances the state all channels share, call once per block before processChannel
+		void prepareBlock(int numSamples) noexcept
 		{
 			writeHead(numSamples);
 
 			delayTimeSmooth(parameterBufferLength.data(), delayLength, numSamples);
+			if (numSamples > 0)
+				currentDelayLength = parameterBufferLength[numSamples - 1];
 
-			for (auto channel = 0; channel < numChannels; ++channel)
+			isFading = crossfade.isActive();
+			if (isFading)
+				crossfade(crossfadeGains.data(), numSamples);
+
+			prepareTaps(numSamples);
+		}
+
+		// channels only touch their own ringbuffer, so they can run on different threads
+		void processChannel(int channel, float* samplesSingleChannel, int numSamples) noexcept
+		{
+			auto ringBufferSingleChannel = ringBuffer[channel].data();
+
+			for (auto sample = 0; sample < numSamples; ++sample)
 			{
-				auto samplesSingleChannel = samples[channel];
-				auto ringBufferSingleChannel = ringBuffer[channel].data();
+				/*
+				* store current sample from audiobuffer in the ringbuffer
+				* this also makes sure to always overwrite the oldest sample from the ringbuffer
+				* because it will take the writehead exactly the delaybuffer's length for a full loop
+				*/
+				const auto writePos = writeHead[sample];
+				ringBufferSingleChannel[writePos] = samplesSingleChannel[sample];
 
-				for (auto sample = 0; sample < numSamples; ++sample)
+				/*
+				* if the writePosition is at the beginning of the buffer
+				* and the delayLength is long enough to cause the readPosition fall of the beginning
+				* then the readPos should be increased by the length of the buffer
+				* so that the readPos is placed near the end of the buffer
+				*/ 
+				auto readPos = static_cast<float>(writePos) - parameterBufferLength[sample];
+				if (readPos < 0.f) readPos += ringBufferSize;
+
+				if (activeTaps == 1)
 				{
-					/*
-					* store current sample from audiobuffer in the ringbuffer
-					* this also makes sure to always overwrite the oldest sample from the ringbuffer
-					* because it will take the writehead exactly the delaybuffer's length for a full loop
-					*/
-					const auto writePos = writeHead[sample];
-					ringBufferSingleChannel[writePos] = samplesSingleChannel[sample];
-
-					/*
-					* if the writePosition is at the beginning of the buffer
-					* and the delayLength is long enough to cause the readPosition fall of the beginning
-					* then the readPos should be increased by the length of the buffer
-					* so that the readPos is placed near the end of the buffer
-					*/ 
-					auto readPos = static_cast<float>(writePos) - parameterBufferLength[sample];
-					if (readPos < 0.f) readPos += ringBufferSize;
-					samplesSingleChannel[sample] = utils::linearInterpolation(ringBufferSingleChannel, readPos, ringBufferSize);
+					auto wet = interpolate(interpolation, ringBufferSingleChannel, readPos, parameterBufferLength[sample]);
+					if (isFading)
+					{
+						const auto previousWet = interpolate(previousInterpolation, ringBufferSingleChannel, readPos, parameterBufferLength[sample]);
+						wet = previousWet + crossfadeGains[sample] * (wet - previousWet);
+					}
+					samplesSingleChannel[sample] = wet;
+					continue;
 				}
+
+				auto wet = gatherTaps(interpolation, ringBufferSingleChannel, readPos, sample);
+				if (isFading)
+				{
+					const auto previousWet = gatherTaps(previousInterpolation, ringBufferSingleChannel, readPos, sample);
+					wet = previousWet + crossfadeGains[sample] * (wet - previousWet);
+				}
+				samplesSingleChannel[sample] = wet;
 			}
 		}
 
+		// the modulated delay time at the end of the last block
+		float getDelayTimeInMs() const noexcept
+		{
+			return sampleRate > 0. ? currentDelayLength * 1000.f / static_cast<float>(sampleRate) : 0.f;
+		}
+
 	protected:
 		double sampleRate;
 		std::array<std::vector<float>, 2> ringBuffer;
 		std::vector<float> parameterBufferLength;
 		utils::Smooth delayTimeSmooth;
 		WriteHead writeHead;
-		float delayLength;
+		float delayLength, currentDelayLength;
 		int ringBufferSize;
+		quality::Interpolation interpolation, previousInterpolation;
+		utils::Crossfade crossfade;
+		std::vector<float> crossfadeGains;
+		bool isFading;
+		int numTaps, activeTaps;
+		// gains at the start of the current block and their per sample ramp
+		std::array<float, maxTaps> tapGains, tapGainSteps;
+		// extra delay of every tap for the current block, tap 0 is never modulated
+		std::array<std::vector<float>, maxTaps> tapOffsets;
+		float ensembleDepth;
+		double ensemblePhase, ensembleIncrement;
+		int previousBlockLength;
+
+		float targetGain(int tap) const noexcept
+		{
+			return tap < numTaps ? 1.f / static_cast<float>(numTaps) : 0.f;
+		}
+
+		// gain ramps and modulation are shared by all channels, so they are worked out once per block
+		void prepareTaps(int numSamples) noexcept
+		{
+			activeTaps = 1;
+			for (auto tap = 0; tap < maxTaps; ++tap)
+			{
+				// the previous block's ramp ended at its target
+				tapGains[tap] += tapGainSteps[tap] * static_cast<float>(previousBlockLength);
+				if (std::abs(tapGains[tap] - targetGain(tap)) < 1.e-6f)
+					tapGains[tap] = targetGain(tap);
+				tapGainSteps[tap] = numSamples > 0 ? (targetGain(tap) - tapGains[tap]) / static_cast<float>(numSamples) : 0.f;
+
+				if (tapGains[tap] > 0.f || targetGain(tap) > 0.f)
+					activeTaps = tap + 1;
+			}
+			previousBlockLength = numSamples;
+
+			for (auto tap = 1; tap < activeTaps; ++tap)
+			{
+				const auto phaseOffset = 2. * juce::MathConstants<double>::pi * static_cast<double>(tap - 1) / static_cast<double>(maxTaps - 1);
+				auto offsets = tapOffsets[tap].data();
+				for (auto sample = 0; sample < numSamples; ++sample)
+				{
+					const auto phase = ensemblePhase + ensembleIncrement * sample + phaseOffset;
+					offsets[sample] = ensembleDepth * .5f * (1.f + static_cast<float>(std::sin(phase)));
+				}
+			}
+
+			ensemblePhase = std::fmod(ensemblePhase + ensembleIncrement * numSamples, 2. * juce::MathConstants<double>::pi);
+		}
+
+		float gatherTaps(quality::Interpolation type, float* ringBufferSingleChannel, float readPos, int sample) const noexcept
+		{
+			const auto ramp = static_cast<float>(sample + 1);
+			const auto delayInSamples = parameterBufferLength[sample];
+			auto wet = (tapGains[0] + tapGainSteps[0] * ramp) * interpolate(type, ringBufferSingleChannel, readPos, delayInSamples);
+
+			for (auto tap = 1; tap < activeTaps; ++tap)
+			{
+				auto tapReadPos = readPos - tapOffsets[tap][sample];
+				if (tapReadPos < 0.f) tapReadPos += ringBufferSize;
+				wet += (tapGains[tap] + tapGainSteps[tap] * ramp)
+					* interpolate(type, ringBufferSingleChannel, tapReadPos, delayInSamples + tapOffsets[tap][sample]);
+			}
+			return wet;
+		}
+
+		/*
+		* the cubic reads up to two samples past readPos, which below one sample of delay is beyond the write head
+		* (the oldest sample in the ring), so short delays fall back to linear, both agree at exactly one sample
+		*/
+		float interpolate(quality::Interpolation type, float* ringBufferSingleChannel, float readPos, float delayInSamples) const noexcept
+		{
+			if (type == quality::Interpolation::Cubic && delayInSamples >= 1.f)
+				return utils::cubicInterpolation(ringBufferSingleChannel, readPos, ringBufferSize);
+			return utils::linearInterpolation(ringBufferSingleChannel, readPos, ringBufferSize);
+		}
 	};
 }
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <JuceHeader.h>
+
+namespace fastmath
+{
+	/*
+	* polynomial log2 and exp2 for gain computers, no calls into libm
+	* log2: absolute error below 1e-5 (6e-5 dB) for normal positive input
+	* exp2: relative error below 1e-6 (9e-6 dB), input is clamped to [-126, 127]
+	* the block versions are branch free loops the compiler vectorises, clamping is done up front with simd
+	*/
+
+	inline float log2(float x) noexcept
+	{
+		std::int32_t bits;
+		std::memcpy(&bits, &x, sizeof(bits));
+
+		// x = 2^exponent * (1 + t), t in [0, 1)
+		const auto exponent = static_cast<float>(((bits >> 23) & 0xff) - 127);
+		bits = (bits & 0x007fffff) | 0x3f800000;
+		float mantissa;
+		std::memcpy(&mantissa, &bits, sizeof(mantissa));
+		const auto t = mantissa - 1.f;
+
+		const auto p = 1.44268325f + t * (-.72044237f + t * (.469301687f + t * (-.303389667f + t * (.146433614f + t * -.0345952108f))));
+		return exponent + t * p;
+	}
+
+	// x must already lie in [-126, 127]
+	inline float exp2InRange(float x) noexcept
+	{
+		// x + 127 is positive, so truncating it floors it and gives the biased exponent right away
+		// the fraction is taken from x itself, x + 127 would round away up to 8e-6 of it
+		const auto exponent = static_cast<std::int32_t>(x + 127.f);
+		const auto t = x - static_cast<float>(exponent - 127);
+
+		const auto p = .999999896f + t * (.69315462f + t * (.24014077f + t * (.0558632821f + t * (.0089462153f + t * .00189510704f))));
+
+		const std::int32_t bits = exponent << 23;
+		float scale;
+		std::memcpy(&scale, &bits, sizeof(scale));
+		return scale * p;
+	}
+
+	inline float exp2(float x) noexcept
+	{
+		return exp2InRange(juce::jlimit(-126.f, 127.f, x));
+	}
+
+	// 20 * log10(2) and its inverse
+	static constexpr float decibelsPerOctave = 6.02059991f;
+	static constexpr float octavesPerDecibel = .166096404f;
+
+	inline float gainToDecibels(float gain) noexcept
+	{
+		return decibelsPerOctave * log2(gain);
+	}
+
+	inline float decibelsToGain(float decibels) noexcept
+	{
+		return exp2(octavesPerDecibel * decibels);
+	}
+
+	// x^y for x > 0
+	inline float pow(float x, float y) noexcept
+	{
+		return exp2(y * log2(x));
+	}
+
+	inline void log2(float* destination, const float* source, int numSamples) noexcept
+	{
+		for (auto s = 0; s < numSamples; ++s)
+			destination[s] = log2(source[s]);
+	}
+
+	inline void exp2(float* destination, const float* source, int numSamples) noexcept
+	{
+		juce::FloatVectorOperations::clip(destination, source, -126.f, 127.f, numSamples);
+		for (auto s = 0; s < numSamples; ++s)
+			destination[s] = exp2InRange(destination[s]);
+	}
+}
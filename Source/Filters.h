@@ -1,4 +1,7 @@
 #pragma once
+#include <array>
+#include <vector>
+#include "Quality.h"
 
 namespace dsp
 {
@@ -6,7 +9,13 @@ namespace dsp
 	{
 		CutFilters() :
 			lowCutFreq(20.f),
-			highCutFreq(20'000.f)
+			highCutFreq(20'000.f),
+			designedLowCut(0.f),
+			designedHighCut(0.f),
+			designedSampleRate(0.),
+			topology(quality::FilterTopology::DirectForm),
+			previousTopology(quality::FilterTopology::DirectForm),
+			isFading(false)
 		{}
 
 		void prepare(double sampleRate, int blockSize)
@@ -21,29 +30,20 @@ namespace dsp
 			leftChain.prepare(spec);
 			rightChain.prepare(spec);
 
-			// prepare the filters
-
-			auto lowCutCoefs = juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(
-				lowCutFreq,
-				sampleRate,
-				1);
+			spec.numChannels = 2;
+			lowCutTPT.prepare(spec);
+			highCutTPT.prepare(spec);
+			lowCutTPT.setType(juce::dsp::FirstOrderTPTFilterType::highpass);
+			highCutTPT.setType(juce::dsp::FirstOrderTPTFilterType::lowpass);
 
-			auto highCutCoefs = juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(
-				highCutFreq,
-				sampleRate,
-				1);
-
-			auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-			auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
-
-			auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
-			auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
+			crossfade.prepare(static_cast<int>(sampleRate * .02));
+			crossfadeGains.resize(blockSize);
+			crossfadeBuffer.setSize(2, blockSize, false, false, true);
 
-			makeCutFilter(leftLowCut, lowCutCoefs);
-			makeCutFilter(rightLowCut, lowCutCoefs);
+			// prepare the filters
 
-			makeCutFilter(leftHighCut, highCutCoefs);
-			makeCutFilter(rightHighCut, highCutCoefs);
+			designedSampleRate = 0.;
+			updateCoefficients(sampleRate);
 		}
 
 		void updateParameters(float _lowCutFreq, float _highCutFreq)
@@ -52,46 +52,104 @@ namespace dsp
 			highCutFreq = _highCutFreq;
 		}
 
-		void processBlock(juce::dsp::AudioBlock<float> block, int numChannels, int numSamples, double sampleRate)
+		void reset()
 		{
-			// configure the filters
+			leftChain.reset();
+			rightChain.reset();
+			lowCutTPT.reset();
+			highCutTPT.reset();
+			crossfade.finish();
+		}
 
-			auto lowCutCoefs = juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(
-				lowCutFreq,
-				sampleRate,
-				1);
+		void setTopology(quality::FilterTopology _topology)
+		{
+			if (_topology == topology)
+				return;
+
+			previousTopology = topology;
+			topology = _topology;
+
+			// the incoming filters start from silence instead of whatever they held when they were last used
+			if (topology == quality::FilterTopology::TopologyPreserving)
+			{
+				lowCutTPT.reset();
+				highCutTPT.reset();
+			}
+			else
+			{
+				leftChain.reset();
+				rightChain.reset();
+			}
+			crossfade.start();
+		}
 
-			auto highCutCoefs = juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(
-				highCutFreq,
-				sampleRate,
-				1);
+		void processBlock(juce::dsp::AudioBlock<float> block, int numChannels, int numSamples, double sampleRate)
+		{
+			prepareBlock(numSamples, sampleRate);
 
-			auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
-			auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
+			for (auto channel = 0; channel < numChannels; ++channel)
+				processChannel(channel, block.getChannelPointer(static_cast<size_t>(channel)), numSamples);
+		}
 
-			auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
-			auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
-			
-			makeCutFilter(leftLowCut, lowCutCoefs);
-			makeCutFilter(rightLowCut, lowCutCoefs);
+		// configures the filters all channels share, call once per block before processChannel
+		void prepareBlock(int numSamples, double sampleRate)
+		{
+			updateCoefficients(sampleRate);
 
-			makeCutFilter(leftHighCut, highCutCoefs);
-			makeCutFilter(rightHighCut, highCutCoefs);
+			isFading = crossfade.isActive();
+			if (isFading)
+				crossfade(crossfadeGains.data(), numSamples);
+		}
 
-			// Process the chains
+		// channels only touch their own filter state, so they can run on different threads
+		void processChannel(int channel, float* samplesSingleChannel, int numSamples)
+		{
+			if (!isFading)
+				return processTopology(topology, channel, samplesSingleChannel, numSamples);
 
-			auto leftBlock = block.getSingleChannelBlock(0);
-			auto rightBlock = block.getSingleChannelBlock(1);
+			// while switching topology, both run on the same input and are crossfaded
 
-			juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-			juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+			auto previousSamples = crossfadeBuffer.getWritePointer(channel);
+			juce::FloatVectorOperations::copy(previousSamples, samplesSingleChannel, numSamples);
 
-			leftChain.process(leftContext);
-			rightChain.process(rightContext);
+			processTopology(previousTopology, channel, previousSamples, numSamples);
+			processTopology(topology, channel, samplesSingleChannel, numSamples);
+
+			utils::Crossfade::mix(samplesSingleChannel, previousSamples, crossfadeGains.data(), numSamples);
 		}
 
 	protected:
+		void processTopology(quality::FilterTopology type, int channel, float* samplesSingleChannel, int numSamples)
+		{
+			if (type == quality::FilterTopology::TopologyPreserving)
+			{
+				for (auto sample = 0; sample < numSamples; ++sample)
+					samplesSingleChannel[sample] = highCutTPT.processSample(channel, lowCutTPT.processSample(channel, samplesSingleChannel[sample]));
+				return;
+			}
+
+			// Process the chain
+
+			juce::dsp::AudioBlock<float> block(&samplesSingleChannel, 1, static_cast<size_t>(numSamples));
+			juce::dsp::ProcessContextReplacing<float> context(block);
+
+			if (channel == 0)
+				leftChain.process(context);
+			else
+				rightChain.process(context);
+		}
+
 		float lowCutFreq, highCutFreq;
+		float designedLowCut, designedHighCut;
+		double designedSampleRate;
+
+		quality::FilterTopology topology, previousTopology;
+		juce::dsp::FirstOrderTPTFilter<float> lowCutTPT, highCutTPT;
+
+		utils::Crossfade crossfade;
+		std::vector<float> crossfadeGains;
+		juce::AudioBuffer<float> crossfadeBuffer;
+		bool isFading;
 
 		using Filter = juce::dsp::IIR::Filter<float>;
 		
@@ -107,16 +165,44 @@ namespace dsp
 			HighCut
 		};
 
-		using Coefficients = Filter::CoefficientsPtr;
+		using Coefficients = std::array<float, 4>;
 
-		template<typename ChainType, typename CoefficientType>
-		void makeCutFilter(ChainType& cut, const CoefficientType& cutCoefs)
+		/*
+		* redesigns the first order cut filters only when a frequency or the samplerate changed
+		* the array coefficients are assigned in place, so this never allocates on the audio thread
+		*/
+		void updateCoefficients(double sampleRate)
 		{
-			cut.setBypassed<0>(true); // may be unnecesary
+			if (lowCutFreq == designedLowCut && highCutFreq == designedHighCut && sampleRate == designedSampleRate)
+				return;
+
+			const auto lowCutCoefs = juce::dsp::IIR::ArrayCoefficients<float>::makeFirstOrderHighPass(sampleRate, lowCutFreq);
+			const auto highCutCoefs = juce::dsp::IIR::ArrayCoefficients<float>::makeFirstOrderLowPass(sampleRate, highCutFreq);
+
+			auto& leftLowCut = leftChain.get<ChainPositions::LowCut>();
+			auto& rightLowCut = rightChain.get<ChainPositions::LowCut>();
 
-			*cut.get<0>().coefficients = *cutCoefs[0];
+			auto& leftHighCut = leftChain.get<ChainPositions::HighCut>();
+			auto& rightHighCut = rightChain.get<ChainPositions::HighCut>();
 
-			cut.setBypassed<0>(false);
+			makeCutFilter(leftLowCut, lowCutCoefs);
+			makeCutFilter(rightLowCut, lowCutCoefs);
+
+			makeCutFilter(leftHighCut, highCutCoefs);
+			makeCutFilter(rightHighCut, highCutCoefs);
+
+			lowCutTPT.setCutoffFrequency(lowCutFreq);
+			highCutTPT.setCutoffFrequency(highCutFreq);
+
+			designedLowCut = lowCutFreq;
+			designedHighCut = highCutFreq;
+			designedSampleRate = sampleRate;
+		}
+
+		template<typename ChainType>
+		void makeCutFilter(ChainType& cut, const Coefficients& cutCoefs)
+		{
+			*cut.template get<0>().coefficients = cutCoefs;
 		}
 	};
 }
\ No newline at end of file
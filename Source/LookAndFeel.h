@@ -0,0 +1,48 @@
+/*
+  ==============================================================================
+
+    The Ultiknob theme, set up once and shared by the editor and its children.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+class UltiknobLookAndFeel : public juce::LookAndFeel_V4
+{
+public:
+    // Colour palette: https://coolors.co/ffffff-848c8e-435058-fcc200-d34e24
+    enum ColourIds
+    {
+        gunmetalColourId = 0,
+        charcoalColourId = 1,
+        greyColourId = 2,
+        whiteColourId = 3,
+        yellowColourId = 10,
+        darkOrangeColourId = 11,
+        blackColourId = 20
+    };
+
+    UltiknobLookAndFeel()
+    {
+        setColour(gunmetalColourId, juce::Colour(55, 55, 55));
+        setColour(charcoalColourId, juce::Colour(67, 80, 88));
+        setColour(greyColourId, juce::Colour(132, 140, 142));
+        setColour(whiteColourId, juce::Colour(255, 255, 255));
+        setColour(yellowColourId, juce::Colour(252, 194, 0));
+        setColour(darkOrangeColourId, juce::Colour(211, 78, 36));
+        setColour(blackColourId, juce::Colour(20, 20, 20));
+
+        setColour(juce::Slider::thumbColourId, findColour(yellowColourId));
+        setColour(juce::Slider::trackColourId, findColour(greyColourId));
+        setColour(juce::Slider::backgroundColourId, findColour(gunmetalColourId));
+        setColour(juce::Slider::rotarySliderOutlineColourId, findColour(gunmetalColourId));
+        setColour(juce::Slider::rotarySliderFillColourId, findColour(greyColourId));
+    }
+
+private:
+    JUCE_DECLARE_NON_COPYABLE (UltiknobLookAndFeel)
+};
@@ -0,0 +1,240 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include "Utils.h"
+
+namespace loudness
+{
+	// reported while there is nothing to measure yet
+	static constexpr float silence = -100.f;
+
+	inline float energyToLufs(double energy) noexcept
+	{
+		return energy > 0. ? static_cast<float>(-.691 + 10. * std::log10(energy)) : silence;
+	}
+
+	/*
+	* the ITU-R BS.1770 k-weighting: a high shelf modelling the head, then the rlb highpass
+	* coefficients are derived from the analog prototypes, so any sample rate gets the same curve
+	*/
+	struct KWeighting
+	{
+		struct Biquad
+		{
+			double b0 = 1., b1 = 0., b2 = 0., a1 = 0., a2 = 0.;
+		};
+
+		KWeighting() :
+			shelf(),
+			highPass(),
+			state()
+		{}
+
+		void prepare(double sampleRate)
+		{
+			{
+				const auto f0 = 1681.974450955533;
+				const auto gain = 3.999843853973347;
+				const auto q = .7071752369554196;
+
+				const auto k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+				const auto vh = std::pow(10., gain / 20.);
+				const auto vb = std::pow(vh, .4996667741545416);
+				const auto a0 = 1. + k / q + k * k;
+
+				shelf.b0 = (vh + vb * k / q + k * k) / a0;
+				shelf.b1 = 2. * (k * k - vh) / a0;
+				shelf.b2 = (vh - vb * k / q + k * k) / a0;
+				shelf.a1 = 2. * (k * k - 1.) / a0;
+				shelf.a2 = (1. - k / q + k * k) / a0;
+			}
+			{
+				const auto f0 = 38.13547087602444;
+				const auto q = .5003270373238773;
+
+				const auto k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+				const auto a0 = 1. + k / q + k * k;
+
+				highPass.b0 = 1.;
+				highPass.b1 = -2.;
+				highPass.b2 = 1.;
+				highPass.a1 = 2. * (k * k - 1.) / a0;
+				highPass.a2 = (1. - k / q + k * k) / a0;
+			}
+			reset();
+		}
+
+		void reset() noexcept
+		{
+			for (auto& channel : state)
+				channel.fill(0.);
+		}
+
+		double processSample(int channel, double x) noexcept
+		{
+			auto& s = state[channel];
+			x = process(shelf, s[0], s[1], x);
+			return process(highPass, s[2], s[3], x);
+		}
+
+	protected:
+		Biquad shelf, highPass;
+		// transposed direct form II, two states per biquad
+		std::array<std::array<double, 4>, 2> state;
+
+		static double process(const Biquad& c, double& s1, double& s2, double x) noexcept
+		{
+			const auto y = c.b0 * x + s1;
+			s1 = c.b1 * x - c.a1 * y + s2;
+			s2 = c.b2 * x - c.a2 * y;
+			return y;
+		}
+	};
+
+	/*
+	* EBU R128 momentary (400 ms), short-term (3 s) and integrated loudness, measured as the audio streams by
+	* the signal is cut into 100 ms bins, every bin completes a 400 ms gating block (75% overlap)
+	* integrated loudness gates those blocks at -70 LUFS and at 10 LU below the absolute gated mean;
+	* the blocks are kept in a histogram, so the relative gate never needs the whole history
+	*/
+	struct Meter
+	{
+		static constexpr int maxChannels = 2;
+		static constexpr int momentaryBins = 4;
+		static constexpr int shortTermBins = 30;
+		static constexpr float absoluteGate = -70.f;
+		static constexpr float relativeGate = -10.f;
+		static constexpr float histogramStep = .1f;
+		static constexpr int numHistogramBins = 800; // -70 to +10 LUFS
+
+		Meter() :
+			kWeighting(),
+			binLength(4'410),
+			binPosition(0),
+			binSum(0.),
+			bins(),
+			binIndex(0),
+			numBins(0),
+			histogramEnergy(),
+			histogramCount(),
+			momentary(silence),
+			shortTerm(silence),
+			integrated(silence)
+		{}
+
+		void prepare(double sampleRate)
+		{
+			kWeighting.prepare(sampleRate);
+			binLength = juce::jmax(1, juce::roundToInt(sampleRate * .1));
+			reset();
+		}
+
+		void reset() noexcept
+		{
+			kWeighting.reset();
+			binPosition = 0;
+			binSum = 0.;
+			bins.fill(0.);
+			binIndex = 0;
+			numBins = 0;
+			histogramEnergy.fill(0.);
+			histogramCount.fill(0);
+			momentary = shortTerm = integrated = silence;
+		}
+
+		/*
+		* gains, if not nullptr, is divided out of every sample first,
+		* which measures the signal as it was before that (non-zero) gain
+		*/
+		void process(const float* const* samples, int numChannels, int numSamples, const float* gains = nullptr) noexcept
+		{
+			for (auto sample = 0; sample < numSamples; ++sample)
+			{
+				const auto gain = gains != nullptr ? 1. / static_cast<double>(gains[sample]) : 1.;
+
+				for (auto channel = 0; channel < numChannels; ++channel)
+				{
+					const auto weighted = kWeighting.processSample(channel, samples[channel][sample] * gain);
+					binSum += weighted * weighted;
+				}
+
+				if (++binPosition == binLength)
+					completeBin();
+			}
+		}
+
+		float getMomentary() const noexcept { return momentary; }
+		float getShortTerm() const noexcept { return shortTerm; }
+		float getIntegrated() const noexcept { return integrated; }
+
+		// false until the first gating block passed the absolute gate
+		bool hasIntegrated() const noexcept { return integrated > silence; }
+
+	protected:
+		KWeighting kWeighting;
+		int binLength, binPosition;
+		double binSum;
+		std::array<double, shortTermBins> bins;
+		int binIndex, numBins;
+		std::array<double, numHistogramBins> histogramEnergy;
+		std::array<int, numHistogramBins> histogramCount;
+		float momentary, shortTerm, integrated;
+
+		double meanOfLastBins(int count) const noexcept
+		{
+			auto sum = 0.;
+			for (auto i = 1; i <= count; ++i)
+				sum += bins[(binIndex - i + shortTermBins) % shortTermBins];
+			return sum / count;
+		}
+
+		void completeBin() noexcept
+		{
+			// channel weights are 1 for left and right, so the channels' mean squares simply add up
+			bins[binIndex] = binSum / binLength;
+			binIndex = (binIndex + 1) % shortTermBins;
+			numBins = juce::jmin(numBins + 1, shortTermBins);
+			binSum = 0.;
+			binPosition = 0;
+
+			shortTerm = energyToLufs(meanOfLastBins(numBins));
+			if (numBins < momentaryBins)
+				return;
+
+			const auto blockEnergy = meanOfLastBins(momentaryBins);
+			momentary = energyToLufs(blockEnergy);
+			if (momentary < absoluteGate)
+				return;
+
+			const auto histogramBin = juce::jmin(numHistogramBins - 1, static_cast<int>((momentary - absoluteGate) / histogramStep));
+			histogramEnergy[histogramBin] += blockEnergy;
+			++histogramCount[histogramBin];
+
+			updateIntegrated();
+		}
+
+		void updateIntegrated() noexcept
+		{
+			auto energy = 0.;
+			auto count = 0;
+			for (auto bin = 0; bin < numHistogramBins; ++bin)
+			{
+				energy += histogramEnergy[bin];
+				count += histogramCount[bin];
+			}
+
+			const auto threshold = energyToLufs(energy / count) + relativeGate;
+			const auto firstBin = juce::jlimit(0, numHistogramBins - 1, static_cast<int>(std::ceil((threshold - absoluteGate) / histogramStep)));
+
+			energy = 0.;
+			count = 0;
+			for (auto bin = firstBin; bin < numHistogramBins; ++bin)
+			{
+				energy += histogramEnergy[bin];
+				count += histogramCount[bin];
+			}
+
+			integrated = count > 0 ? energyToLufs(energy / count) : silence;
+		}
+	};
+}
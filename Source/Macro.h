@@ -0,0 +1,34 @@
+#pragma once
+
+namespace macro
+{
+	// parameter values the ultiknob drives, shared by the editor and the embeddable api
+	struct Values
+	{
+		float delayTime;
+		float ratio;
+		float drive;
+		float lowCut;
+		float highCut;
+	};
+
+	inline Values map(float percentage, bool isDirty) noexcept
+	{
+		Values values;
+		values.delayTime = percentage * 0.4f;
+		values.ratio = 1.f + (percentage * 0.09f);
+		values.drive = percentage * 0.12f; // only heard in dirty mode
+
+		if (isDirty == false)
+		{
+			values.lowCut = 20.f + (percentage * 0.40f);
+			values.highCut = 20'000.f - (percentage * 80.f);
+		}
+		else
+		{
+			values.lowCut = 20.f + (percentage * 0.60f);
+			values.highCut = 20'000.f - (percentage * 120.f);
+		}
+		return values;
+	}
+}
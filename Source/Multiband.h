@@ -0,0 +1,207 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <vector>
+#include "Utils.h"
+#include "FastMath.h"
+
+namespace dsp
+{
+	/*
+	* 4th order linkwitz-riley split of numLanes independent signals that share one cutoff
+	* built from butterworth state variable filters: a first svf splits into lowpass and highpass,
+	* each of those goes through a second svf of the same kind
+	* low + high sums to an allpass, which is what keeps the bands phase aligned
+	*/
+	template<int numLanes>
+	struct LinkwitzRileyLanes
+	{
+		using Lanes = std::array<float, numLanes>;
+
+		LinkwitzRileyLanes() :
+			g(0.f),
+			h(1.f)
+		{
+			reset();
+		}
+
+		void setCutoff(float frequency, double sampleRate) noexcept
+		{
+			g = static_cast<float>(std::tan(juce::MathConstants<double>::pi * frequency / sampleRate));
+			h = 1.f / (1.f + r2 * g + g * g);
+		}
+
+		void reset() noexcept
+		{
+			for (auto& state : s)
+				state.fill(0.f);
+		}
+
+		void operator()(const Lanes& x, Lanes& low, Lanes& high) noexcept
+		{
+			for (auto lane = 0; lane < numLanes; ++lane)
+			{
+				const auto yH = (x[lane] - (r2 + g) * s[0][lane] - s[1][lane]) * h;
+				const auto yB = g * yH + s[0][lane];
+				s[0][lane] = g * yH + yB;
+				const auto yL = g * yB + s[1][lane];
+				s[1][lane] = g * yB + yL;
+
+				const auto lowH = (yL - (r2 + g) * s[2][lane] - s[3][lane]) * h;
+				const auto lowB = g * lowH + s[2][lane];
+				s[2][lane] = g * lowH + lowB;
+				const auto lowL = g * lowB + s[3][lane];
+				s[3][lane] = g * lowB + lowL;
+
+				const auto highH = (yH - (r2 + g) * s[4][lane] - s[5][lane]) * h;
+				const auto highB = g * highH + s[4][lane];
+				s[4][lane] = g * highH + highB;
+				const auto highL = g * highB + s[5][lane];
+				s[5][lane] = g * highB + highL;
+
+				low[lane] = lowL;
+				high[lane] = highH;
+			}
+		}
+
+	protected:
+		static constexpr float r2 = 1.41421356237f;
+		float g, h;
+		// states are stored per svf integrator, with the lanes next to each other
+		std::array<Lanes, 6> s;
+	};
+
+	/*
+	* 3-band stereo linked compressor for dirty mode on full mixes
+	* the recursive part runs sample by sample as plain scalar code laid out in lanes: the first split works on
+	* the two channels, the second split runs the low band allpass and the mid/high split together as four lanes,
+	* and the band detectors are lanes as well, written without branches so every lane does the same work
+	* the gain computer and the summing then run over the whole block per band on the vectorised kernels
+	*/
+	struct MultibandCompressor
+	{
+		static constexpr int maxChannels = 2;
+		static constexpr int numBands = 3;
+		static constexpr int numLanes = 4; // bands padded to four lanes
+		static constexpr float lowMidFrequency = 200.f;
+		static constexpr float midHighFrequency = 2'500.f;
+
+		using BandLanes = std::array<float, numLanes>;
+
+		MultibandCompressor() :
+			sampleRate(44100.),
+			thresholdInverse(1.f),
+			ratioExponent(0.f),
+			attackCte(0.f),
+			releaseCte(0.f),
+			envelope(),
+			bandSamples(),
+			gains()
+		{}
+
+		void prepare(double _sampleRate, int blockSize)
+		{
+			sampleRate = _sampleRate;
+			lowMidSplit.setCutoff(lowMidFrequency, sampleRate);
+			midHighSplit.setCutoff(midHighFrequency, sampleRate);
+
+			for (auto band = 0; band < numBands; ++band)
+			{
+				for (auto& channel : bandSamples)
+					channel[band].resize(blockSize);
+				gains[band].resize(blockSize);
+			}
+
+			reset();
+		}
+
+		void reset() noexcept
+		{
+			lowMidSplit.reset();
+			midHighSplit.reset();
+			envelope.fill(0.f);
+		}
+
+		// same ballistics and gain computer as PeakCompressor, so the modes sound related
+		void updateParameters(float ratio, float threshold, float attack, float release)
+		{
+			thresholdInverse = fastmath::decibelsToGain(-threshold);
+			ratioExponent = 1.f / ratio - 1.f;
+			attackCte = ballisticsCoefficient(attack);
+			releaseCte = ballisticsCoefficient(release);
+		}
+
+		void processBlock(float** samples, int numChannels, int numSamples)
+		{
+			auto left = samples[0];
+			auto right = numChannels > 1 ? samples[1] : samples[0];
+
+			for (auto sample = 0; sample < numSamples; ++sample)
+			{
+				// crossover
+
+				std::array<float, 2> lowIn, restIn;
+				lowMidSplit({ left[sample], right[sample] }, lowIn, restIn);
+
+				std::array<float, 4> lowPass, highPass;
+				midHighSplit({ lowIn[0], lowIn[1], restIn[0], restIn[1] }, lowPass, highPass);
+
+				const BandLanes bandsLeft{ lowPass[0] + highPass[0], lowPass[2], highPass[2], 0.f };
+				const BandLanes bandsRight{ lowPass[1] + highPass[1], lowPass[3], highPass[3], 0.f };
+
+				// stereo linked detector, attack or release picked by weight instead of a branch
+
+				for (auto band = 0; band < numLanes; ++band)
+				{
+					const auto level = juce::jmax(std::abs(bandsLeft[band]), std::abs(bandsRight[band]));
+					const auto isRising = level > envelope[band] ? 1.f : 0.f;
+					const auto cte = releaseCte + isRising * (attackCte - releaseCte);
+					envelope[band] = level + cte * (envelope[band] - level);
+				}
+
+				for (auto band = 0; band < numBands; ++band)
+				{
+					bandSamples[0][band][sample] = bandsLeft[band];
+					bandSamples[1][band][sample] = bandsRight[band];
+					gains[band][sample] = envelope[band] * thresholdInverse;
+				}
+			}
+
+			// gain computer, overshoot above the threshold, 1 below it, so the gain there is 2^0
+
+			for (auto band = 0; band < numBands; ++band)
+			{
+				auto gain = gains[band].data();
+				juce::FloatVectorOperations::max(gain, gain, 1.f, numSamples);
+				fastmath::log2(gain, gain, numSamples);
+				juce::FloatVectorOperations::multiply(gain, ratioExponent, numSamples);
+				fastmath::exp2(gain, gain, numSamples);
+			}
+
+			// summing
+
+			for (auto channel = 0; channel < juce::jmin(numChannels, maxChannels); ++channel)
+			{
+				juce::FloatVectorOperations::multiply(samples[channel], bandSamples[channel][0].data(), gains[0].data(), numSamples);
+				for (auto band = 1; band < numBands; ++band)
+					juce::FloatVectorOperations::addWithMultiply(samples[channel], bandSamples[channel][band].data(), gains[band].data(), numSamples);
+			}
+		}
+
+	protected:
+		double sampleRate;
+		LinkwitzRileyLanes<2> lowMidSplit;
+		LinkwitzRileyLanes<4> midHighSplit;
+		float thresholdInverse, ratioExponent, attackCte, releaseCte;
+		BandLanes envelope;
+		std::array<std::array<std::vector<float>, numBands>, maxChannels> bandSamples;
+		std::array<std::vector<float>, numBands> gains;
+
+		float ballisticsCoefficient(float timeInMs) const noexcept
+		{
+			return timeInMs < 1.e-3f
+				? 0.f
+				: static_cast<float>(std::exp(-2. * juce::MathConstants<double>::pi * 1000. / (timeInMs * sampleRate)));
+		}
+	};
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <JuceHeader.h>
+
+namespace parallel
+{
+	/*
+	* lets a fixed number of threads wait for each other inside one task
+	* the last thread to arrive opens the barrier by moving on to the next generation
+	*/
+	struct SpinBarrier
+	{
+		explicit SpinBarrier(int _numThreads) :
+			numThreads(_numThreads),
+			arrived(0),
+			generation(0)
+		{}
+
+		void arriveAndWait() noexcept
+		{
+			const auto currentGeneration = generation.load(std::memory_order_acquire);
+
+			if (arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == numThreads)
+			{
+				arrived.store(0, std::memory_order_relaxed);
+				generation.fetch_add(1, std::memory_order_release);
+				return;
+			}
+
+			while (generation.load(std::memory_order_acquire) == currentGeneration)
+				std::this_thread::yield();
+		}
+
+	protected:
+		const int numThreads;
+		std::atomic<int> arrived;
+		std::atomic<int> generation;
+	};
+
+	/*
+	* persistent helper threads that run one task per channel, the calling thread takes channel 0
+	* threads are only started from prepare, so nothing is created or joined while processing
+	* helpers spin for a short while after a task, because the next block usually follows right away
+	*/
+	struct ChannelWorkers
+	{
+		static constexpr int spinsBeforeSleeping = 4'000;
+
+		ChannelWorkers() :
+			helpers(),
+			context(nullptr),
+			invoke(nullptr),
+			generation(0),
+			pending(0),
+			shouldExit(false)
+		{}
+
+		~ChannelWorkers()
+		{
+			stop();
+		}
+
+		void start(int numHelpers)
+		{
+			stop();
+
+			shouldExit.store(false);
+
+			// read here and not on the helper, a run right after start would otherwise count as already seen
+			const auto startGeneration = generation.load(std::memory_order_acquire);
+			for (auto index = 1; index <= numHelpers; ++index)
+			{
+				auto helper = std::make_unique<Helper>();
+				helper->thread = std::thread([this, index, wake = &helper->wake, startGeneration] { runHelper(index, *wake, startGeneration); });
+				helpers.push_back(std::move(helper));
+			}
+		}
+
+		void stop()
+		{
+			shouldExit.store(true);
+			for (auto& helper : helpers)
+			{
+				helper->wake.signal();
+				helper->thread.join();
+			}
+			helpers.clear();
+		}
+
+		bool isRunning() const noexcept { return !helpers.empty(); }
+		int getNumThreads() const noexcept { return static_cast<int>(helpers.size()) + 1; }
+
+		// calls task(index) once for every thread and returns when all of them are done
+		template<typename Task>
+		void run(Task& task)
+		{
+			context = &task;
+			invoke = [](void* taskContext, int index) { (*static_cast<Task*>(taskContext))(index); };
+			pending.store(static_cast<int>(helpers.size()), std::memory_order_relaxed);
+			generation.fetch_add(1, std::memory_order_release);
+
+			for (auto& helper : helpers)
+				helper->wake.signal();
+
+			task(0);
+
+			while (pending.load(std::memory_order_acquire) > 0)
+				std::this_thread::yield();
+		}
+
+	protected:
+		struct Helper
+		{
+			std::thread thread;
+			juce::WaitableEvent wake;
+		};
+
+		std::vector<std::unique_ptr<Helper>> helpers;
+		void* context;
+		void (*invoke)(void*, int);
+		std::atomic<int> generation;
+		std::atomic<int> pending;
+		std::atomic<bool> shouldExit;
+
+		void runHelper(int index, juce::WaitableEvent& wake, int seenGeneration)
+		{
+			for (;;)
+			{
+				for (auto spin = 0; spin < spinsBeforeSleeping && !hasWork(seenGeneration); ++spin)
+					std::this_thread::yield();
+
+				while (!hasWork(seenGeneration))
+					wake.wait(100);
+
+				if (shouldExit.load())
+					return;
+
+				seenGeneration = generation.load(std::memory_order_acquire);
+				invoke(context, index);
+				pending.fetch_sub(1, std::memory_order_release);
+			}
+		}
+
+		bool hasWork(int seenGeneration) const noexcept
+		{
+			return shouldExit.load(std::memory_order_relaxed)
+				|| generation.load(std::memory_order_acquire) != seenGeneration;
+		}
+	};
+}
@@ -8,6 +8,7 @@
 
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "Macro.h"
 
 //==============================================================================
 UltiknobAudioProcessorEditor::UltiknobAudioProcessorEditor (UltiknobAudioProcessor& p)
@@ -41,42 +42,55 @@ UltiknobAudioProcessorEditor::UltiknobAudioProcessorEditor (UltiknobAudioProcess
     addAndMakeVisible(inputGainLabel);
     addAndMakeVisible(outputGainLabel);
 
+    setLookAndFeel(&lookAndFeel);
+    setOpaque(true);
     setSize (480, 600);
+
+    audioProcessor.getTelemetry().connect();
+    startTimerHz(30);
 }
 
 UltiknobAudioProcessorEditor::~UltiknobAudioProcessorEditor()
 {
+    stopTimer();
+    audioProcessor.getTelemetry().disconnect();
+    setLookAndFeel(nullptr);
 }
 
 //==============================================================================
 void UltiknobAudioProcessorEditor::paint (juce::Graphics& g)
 {
     // (Our component is opaque, so we must completely fill the background with a solid colour)
-    getLookAndFeel().setColour(0, juce::Colour(55, 55, 55));    // Gunmetal
-    getLookAndFeel().setColour(1, juce::Colour(67, 80, 88));    // Charcoal
-    getLookAndFeel().setColour(2, juce::Colour(132, 140, 142)); // Grey
-    getLookAndFeel().setColour(3, juce::Colour(255, 255, 255)); // White
-    getLookAndFeel().setColour(10, juce::Colour(252, 194, 0));  // Yellow
-    getLookAndFeel().setColour(11, juce::Colour(211, 78, 36));  // Dark Orange
-    getLookAndFeel().setColour(20, juce::Colour(20, 20, 20));   // Black
-
-    getLookAndFeel().setColour(juce::Slider::thumbColourId, getLookAndFeel().findColour(10));
-    getLookAndFeel().setColour(juce::Slider::trackColourId, getLookAndFeel().findColour(2));
-    getLookAndFeel().setColour(juce::Slider::backgroundColourId, getLookAndFeel().findColour(0));
-    getLookAndFeel().setColour(juce::Slider::rotarySliderOutlineColourId, getLookAndFeel().findColour(0));
-    getLookAndFeel().setColour(juce::Slider::rotarySliderFillColourId, getLookAndFeel().findColour(2));
-
-    g.setColour(getLookAndFeel().findColour(20));
+    const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (!staticLayer.isValid() || scale != staticLayerScale)
+        renderStaticLayer(scale);
+
+    // knob and meter repaints are clipped to their own bounds, so this only copies that part of the cache
+    g.drawImage(staticLayer, getLocalBounds().toFloat());
+
+    paintMeters(g);
+}
+
+void UltiknobAudioProcessorEditor::renderStaticLayer(float scale)
+{
+    staticLayerScale = scale;
+    staticLayer = juce::Image(juce::Image::RGB,
+                              juce::jmax(1, juce::roundToInt(getWidth() * scale)),
+                              juce::jmax(1, juce::roundToInt(getHeight() * scale)),
+                              false);
+
+    juce::Graphics g(staticLayer);
+    g.addTransform(juce::AffineTransform::scale(scale));
+
+    g.setColour(lookAndFeel.findColour(UltiknobLookAndFeel::blackColourId));
     g.fillRect(getLocalBounds());
 
-    g.setColour (getLookAndFeel().findColour (3));
-    g.setFont (48.f);
+    g.setColour(lookAndFeel.findColour(UltiknobLookAndFeel::whiteColourId));
+    g.setFont(48.f);
     g.drawFittedText("Ultiknob", logoArea, juce::Justification::centred, 1);
 
     g.setFont(14.f);
-    g.drawFittedText ("DataRock Studio, 2022", footerArea, juce::Justification::centredLeft, 1);
-
-    // Colour palette: https://coolors.co/ffffff-848c8e-435058-fcc200-d34e24
+    g.drawFittedText("DataRock Studio, 2022", footerArea, juce::Justification::centredLeft, 1);
 }
 
 void UltiknobAudioProcessorEditor::resized()
@@ -89,28 +103,79 @@ void UltiknobAudioProcessorEditor::resized()
     bounds.removeFromRight(bounds.getWidth() * 0.08);
     logoArea = bounds.removeFromTop(bounds.getHeight() * 0.25);
     footerArea = bounds.removeFromBottom(bounds.getHeight() * 0.20);
+    meterArea = footerArea.withTrimmedLeft(footerArea.getWidth() / 2).reduced(0, footerArea.getHeight() / 4);
 
     dirtyMode.setBounds(bounds.removeFromBottom(bounds.getHeight() * 0.20));
     inputGain.setBounds(bounds.removeFromLeft(bounds.getWidth() * 0.25));
     outputGain.setBounds(bounds.removeFromRight(bounds.getWidth() * 0.333333333));
     ultiknob.setBounds(bounds);
+
+    staticLayer = {};
 }
 
 void UltiknobAudioProcessorEditor::sliderValueChanged(juce::Slider* slider)
 {
-    double percentage{ slider->getValue() };
+    const auto values = macro::map(static_cast<float>(slider->getValue()), dirtyMode.getToggleState());
+
+    audioProcessor.params.getRawParameterValue("DELAYTIME")->store(values.delayTime);
+    audioProcessor.params.getRawParameterValue("RATIO")->store(values.ratio);
+    audioProcessor.params.getRawParameterValue("DRIVE")->store(values.drive);
+    audioProcessor.params.getRawParameterValue("LOWCUT")->store(values.lowCut);
+    audioProcessor.params.getRawParameterValue("HIGHCUT")->store(values.highCut);
+}
 
-    audioProcessor.params.getRawParameterValue("DELAYTIME")->store(percentage * 0.4f);
-    audioProcessor.params.getRawParameterValue("RATIO")->store(1.f + (percentage * 0.09f));
+void UltiknobAudioProcessorEditor::timerCallback()
+{
+    // drains everything published since the last tick: levels show their peak, reduction its deepest point
+    auto& telemetry = audioProcessor.getTelemetry();
 
-    if (dirtyMode.getToggleState() == false)
+    telemetry::Frame frame;
+    auto hasFrames = false;
+    auto inputPeak = 0.f, outputPeak = 0.f, deepestReduction = 0.f;
+    while (telemetry.read(frame))
     {
-        audioProcessor.params.getRawParameterValue("LOWCUT")->store(20.f + (percentage * 0.40f));
-        audioProcessor.params.getRawParameterValue("HIGHCUT")->store(20'000.f - (percentage * 80.f));
-    }
-    else {
-        audioProcessor.params.getRawParameterValue("LOWCUT")->store(20.f + (percentage * 0.60f));
-        audioProcessor.params.getRawParameterValue("HIGHCUT")->store(20'000.f - (percentage * 120.f));
+        hasFrames = true;
+        inputPeak = juce::jmax(inputPeak, frame.inputPeak);
+        outputPeak = juce::jmax(outputPeak, frame.outputPeak);
+        deepestReduction = juce::jmin(deepestReduction, frame.gainReduction);
+        delayTime = frame.delayTime;
     }
+
+    // meters fall back at 1.5 dB per tick once the signal stops
+    constexpr auto falloff = 1.5f;
+    inputLevel = juce::jmax(juce::Decibels::gainToDecibels(inputPeak), inputLevel - falloff);
+    outputLevel = juce::jmax(juce::Decibels::gainToDecibels(outputPeak), outputLevel - falloff);
+    gainReduction = juce::jmin(deepestReduction, gainReduction + falloff);
+
+    if (hasFrames || inputLevel > -100.f || outputLevel > -100.f || gainReduction < 0.f)
+        repaint(meterArea);
 }
 
+void UltiknobAudioProcessorEditor::paintMeters(juce::Graphics& g)
+{
+    // In and Out run from -60 to 0 dBFS, GR grows leftwards from 0 to -24 dB
+    auto area = meterArea;
+    const auto rowHeight = area.getHeight() / 4;
+
+    auto paintBar = [&](const juce::String& name, float proportion, bool fromRight, UltiknobLookAndFeel::ColourIds colourId)
+    {
+        auto row = area.removeFromTop(rowHeight).reduced(0, 2);
+        g.setColour(lookAndFeel.findColour(UltiknobLookAndFeel::whiteColourId));
+        g.drawText(name, row.removeFromLeft(32), juce::Justification::centredLeft);
+
+        g.setColour(lookAndFeel.findColour(UltiknobLookAndFeel::gunmetalColourId));
+        g.fillRect(row);
+
+        const auto width = juce::roundToInt(row.getWidth() * juce::jlimit(0.f, 1.f, proportion));
+        g.setColour(lookAndFeel.findColour(colourId));
+        g.fillRect(fromRight ? row.removeFromRight(width) : row.removeFromLeft(width));
+    };
+
+    g.setFont(12.f);
+    paintBar("In", (inputLevel + 60.f) / 60.f, false, UltiknobLookAndFeel::yellowColourId);
+    paintBar("GR", -gainReduction / 24.f, true, UltiknobLookAndFeel::darkOrangeColourId);
+    paintBar("Out", (outputLevel + 60.f) / 60.f, false, UltiknobLookAndFeel::yellowColourId);
+
+    g.setColour(lookAndFeel.findColour(UltiknobLookAndFeel::whiteColourId));
+    g.drawText("Delay " + juce::String(delayTime, 1) + " ms", area, juce::Justification::centredLeft);
+}
@@ -10,12 +10,14 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "LookAndFeel.h"
 
 //==============================================================================
 /**
 */
 class UltiknobAudioProcessorEditor  : public juce::AudioProcessorEditor,
-                                      public juce::Slider::Listener
+                                      public juce::Slider::Listener,
+                                      private juce::Timer
 {
 public:
     UltiknobAudioProcessorEditor (UltiknobAudioProcessor&);
@@ -30,6 +32,8 @@ private:
     // access the processor object that created it.
     UltiknobAudioProcessor& audioProcessor;
 
+    UltiknobLookAndFeel lookAndFeel;
+
     juce::Slider ultiknob;
     juce::Slider inputGain;
     juce::Slider outputGain;
@@ -45,8 +49,22 @@ private:
 
     juce::Rectangle<int> logoArea;
     juce::Rectangle<int> footerArea;
+    juce::Rectangle<int> meterArea;
+
+    // background, logo and footer text, redrawn only after a resize or a change of display scale
+    juce::Image staticLayer;
+    float staticLayerScale{ 0.f };
+
+    // meter readings in dB, decaying between telemetry frames
+    float inputLevel{ -100.f };
+    float outputLevel{ -100.f };
+    float gainReduction{ 0.f };
+    float delayTime{ 0.f };
 
     void sliderValueChanged(juce::Slider* slider) override;
+    void timerCallback() override;
+    void paintMeters(juce::Graphics& g);
+    void renderStaticLayer(float scale);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (UltiknobAudioProcessorEditor)
 };
@@ -20,12 +20,18 @@ UltiknobAudioProcessor::UltiknobAudioProcessor()
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        ),
-    delay(),
-    cutFilters(),
-    compressor(),
-    random(juce::Time::currentTimeMillis())
+    chain()
 #endif
 {
+    chain.setRandomSeed(juce::Time::currentTimeMillis());
+
+    for (auto i = 0; i < state::numParameters; ++i)
+    {
+        stateParameters[i] = params.getParameter(state::parameterIds[i]);
+        stateValues[i] = params.getRawParameterValue(state::parameterIds[i]);
+        jassert(stateParameters[i] != nullptr && stateValues[i] != nullptr);
+    }
+    previousSnapshot = parameterReader.read();
 }
 
 UltiknobAudioProcessor::~UltiknobAudioProcessor()
@@ -97,19 +103,28 @@ void UltiknobAudioProcessor::changeProgramName (int index, const juce::String& n
 //==============================================================================
 void UltiknobAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    cutFilters.prepare(sampleRate, samplesPerBlock);
-
-    // bufferLengthInMs should be at least 1 greater than the maximum slider value the user can set
-    // if slider is set to exactly the maximum buffersize, the delay has no effect
-    delay.prepare(sampleRate, samplesPerBlock, 51.);
+    chain.prepare(sampleRate, samplesPerBlock, parameterReader.read());
+    chain.prepareChannelWorkers(isNonRealtime() && static_cast<bool>(offlineParallelParameter->load()));
 
-    compressor.prepare(sampleRate, samplesPerBlock, getTotalNumInputChannels());
+    watchdog.prepare(sampleRate);
 }
 
 void UltiknobAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    chain.prepareChannelWorkers(false);
+}
+
+void UltiknobAudioProcessor::reset()
+{
+    // prepareToPlay keeps the chain running at an unchanged sample rate, so the current values are picked up here
+    // the tier goes first, the reset then ends the crossfades it starts, so a fresh and a reused instance render alike
+    chain.setQuality(getTier());
+    chain.reset(parameterReader.read());
+
+    // the chain's reset cleared the meter and the auto gain, the next block starts measuring again
+    wasAutoGain = false;
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -140,69 +155,43 @@ bool UltiknobAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 
 void UltiknobAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
-    int sampleRate = getSampleRate();
     float** writePointerArray = buffer.getArrayOfWritePointers();
-    int numChannels = buffer.getNumChannels();
+    int numChannels = juce::jmin(buffer.getNumChannels(), dsp::Chain::maxChannels);
     int numSamples = buffer.getNumSamples();
 
-    // Filtering
-    cutFilters.updateParameters(
-        params.getRawParameterValue("LOWCUT")->load(),
-        params.getRawParameterValue("HIGHCUT")->load()
-    );
-    cutFilters.processBlock(
-        juce::dsp::AudioBlock<float>(buffer),
-        numChannels,
-        numSamples,
-        sampleRate
-    );
-    
-    // Speed fluctiation
-    static int counter{ 0 };
-    const int maxCount{ static_cast<int>( (sampleRate / numSamples) / 0.5 ) }; // change value once every 2 seconds
-    const float maxDelayTime{ params.getRawParameterValue("DELAYTIME")->load() };
-    if (counter < maxCount)
-    {
-        counter += 1;
-    }
-    else
-    {
-        delay.updateParameters(random.nextFloat() * maxDelayTime); // nextFloat() returns float between 0. and 1. so scale to linearly to between 0. and 40.
-        counter = 0;
-    }
-    delay.processBlock(
-        writePointerArray,
-        numChannels,
-        numSamples
-    );
-
-    // Compression
-    bool isDirty{ static_cast<bool>(params.getRawParameterValue("DIRTYMODE")->load()) };
-    if (isDirty) {
-        compressor.updateParameters(
-            params.getRawParameterValue("RATIO")->load(),
-            params.getRawParameterValue("THRESHOLD")->load(),
-            5.f,    // ATTACK
-            20.f,   // RELEASE
-            params.getRawParameterValue("INPUTGAIN")->load(),
-            params.getRawParameterValue("OUTPUTGAIN")->load()
-        );
-    }
-    else
-    {
-        compressor.updateParameters(
-            params.getRawParameterValue("RATIO")->load(),
-            params.getRawParameterValue("THRESHOLD")->load(),
-            20.f,   // ATTACK
-            100.f,  // RELEASE
-            params.getRawParameterValue("INPUTGAIN")->load(),
-            params.getRawParameterValue("OUTPUTGAIN")->load()
-        );
-    }
-    compressor.processBlock(
+    // Auto gain
+    // an internal gain brings the integrated loudness onto the target, OUTPUTGAIN stays the user's trim on top of it
+    // the meter measures before both, so the correction does not feed back into the measurement
+    const auto isAutoGain = static_cast<bool>(autoGainParameter->load());
+    if (isAutoGain && !wasAutoGain)
+        chain.resetLoudness();
+    wasAutoGain = isAutoGain;
+    chain.setLoudnessMetering(isAutoGain);
+
+    if (isAutoGain && chain.getLoudness().hasIntegrated())
+        chain.setAutoGain(juce::jlimit(-24.f, 24.f, targetLoudnessParameter->load() - chain.getLoudness().getIntegrated()));
+    else if (!isAutoGain)
+        chain.setAutoGain(0.f);
+
+    // a restore running on another thread may have written only part of the preset, keep the previous values until it is done
+    const auto generation = stateGeneration.load();
+    auto snapshot = parameterReader.read();
+    if ((generation & 1u) != 0 || generation != stateGeneration.load())
+        snapshot = previousSnapshot;
+    previousSnapshot = snapshot;
+
+    // Quality
+    const quality::Watchdog::ScopedMeasurement measurement(watchdog, numSamples, !isNonRealtime());
+    chain.setQuality(getTier());
+
+    // Parallel offline render
+    chain.useChannelWorkers(isNonRealtime() && static_cast<bool>(offlineParallelParameter->load()));
+
+    chain.processBlock(
         writePointerArray,
         numChannels,
-        numSamples
+        numSamples,
+        snapshot
     );
 }
 
@@ -224,9 +213,13 @@ void UltiknobAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
     // You should use this method to store your parameters in the memory block.
     // You could do that either as raw data, or use the XML or ValueTree classes
     // as intermediaries to make it easy to save and load complex data.
-    
-    juce::MemoryOutputStream mos(destData, true);
-    params.state.writeToStream(mos);
+
+    // the raw values also hold what the editor's macro wrote, which never reaches the parameter objects
+    state::Values values;
+    for (auto i = 0; i < state::numParameters; ++i)
+        values[i] = stateValues[i]->load();
+
+    state::write(values, destData);
 }
 
 void UltiknobAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -234,25 +227,43 @@ void UltiknobAudioProcessor::setStateInformation (const void* data, int sizeInBy
     // You should use this method to restore your parameters from this memory block,
     // whose contents will have been created by the getStateInformation() call.
 
-    auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
-    if ( tree.isValid() )
-    {
-        params.replaceState(tree);
-
-        cutFilters.updateParameters(
-            params.getRawParameterValue("LOWCUT")->load(),
-            params.getRawParameterValue("HIGHCUT")->load()
-        );
-
-        compressor.updateParameters(
-            params.getRawParameterValue("RATIO")->load(),
-            params.getRawParameterValue("THRESHOLD")->load(),
-            params.getRawParameterValue("ATTACK")->load(),
-            params.getRawParameterValue("RELEASE")->load(),
-            params.getRawParameterValue("INPUTGAIN")->load(),
-            params.getRawParameterValue("OUTPUTGAIN")->load()
-        );
-    }
+    // parameters the stored state does not know yet start from their defaults
+    state::Values values;
+    for (auto i = 0; i < state::numParameters; ++i)
+        values[i] = stateParameters[i]->convertFrom0to1(stateParameters[i]->getDefaultValue());
+
+    const auto isValid = state::isBinary(data, sizeInBytes)
+        ? state::read(data, sizeInBytes, values)
+        : state::readValueTree(data, sizeInBytes, params.state.getType(), values); // saved before the binary format
+
+    if (isValid)
+        applyState(values);
+}
+
+void UltiknobAudioProcessor::applyState(const state::Values& values)
+{
+    // the chain then ramps from the previous values to the restored ones over its next block
+    ++stateGeneration;
+    for (auto i = 0; i < state::numParameters; ++i)
+        stateParameters[i]->setValueNotifyingHost(stateParameters[i]->convertTo0to1(values[i]));
+    ++stateGeneration;
+}
+
+// offline bounces always get the top tier, in realtime the watchdog may hold the requested tier back
+quality::Tier UltiknobAudioProcessor::getTier() const
+{
+    const auto requestedTier = static_cast<quality::Tier>(juce::roundToInt(qualityParameter->load()));
+    return isNonRealtime() ? quality::Tier::High : watchdog(requestedTier);
+}
+
+void UltiknobAudioProcessor::setRandomSeed(juce::int64 seed)
+{
+    chain.setRandomSeed(seed);
+}
+
+telemetry::Channel& UltiknobAudioProcessor::getTelemetry() noexcept
+{
+    return chain.getTelemetry();
 }
 
 //==============================================================================
@@ -344,5 +355,52 @@ juce::AudioProcessorValueTreeState::ParameterLayout UltiknobAudioProcessor::crea
         0.f)
     );
 
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "DRIVE",
+        "Dirty Drive",
+        juce::NormalisableRange<float>(0.f, 24.f, 0.25f, 1.f),
+        0.f)
+    );
+
+    layout.add(std::make_unique<juce::AudioParameterBool>(
+        "MULTIBAND",
+        "Multiband Mode",
+        false)
+    );
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>(
+        "QUALITY",
+        "Quality",
+        juce::StringArray{ "Eco", "Standard", "High" },
+        1)
+    );
+
+    layout.add(std::make_unique<juce::AudioParameterBool>(
+        "OFFLINEPARALLEL",
+        "Parallel Offline Render",
+        true)
+    );
+
+    layout.add(std::make_unique<juce::AudioParameterBool>(
+        "AUTOGAIN",
+        "Auto Output Gain",
+        false)
+    );
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(
+        "TARGETLUFS",
+        "Target Loudness",
+        juce::NormalisableRange<float>(-36.f, -6.f, 0.5f, 1.f),
+        -14.f)
+    );
+
+    layout.add(std::make_unique<juce::AudioParameterInt>(
+        "TAPS",
+        "Ensemble Taps",
+        1,
+        4,
+        1)
+    );
+
     return layout;
 }
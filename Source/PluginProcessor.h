@@ -8,9 +8,10 @@
 
 #pragma once
 
-#include "Delay.h"
-#include "Filters.h"
-#include "Compressor.h"
+#include "Chain.h"
+#include "Automation.h"
+#include "Quality.h"
+#include "State.h"
 #include <JuceHeader.h>
 
 //==============================================================================
@@ -26,6 +27,7 @@ public:
     //==============================================================================
     void prepareToPlay(double sampleRate, int samplesPerBlock) override;
     void releaseResources() override;
+    void reset() override;
 
 #ifndef JucePlugin_PreferredChannelConfigurations
     bool isBusesLayoutSupported(const BusesLayout& layouts) const override;
@@ -56,18 +58,42 @@ public:
     void getStateInformation(juce::MemoryBlock& destData) override;
     void setStateInformation(const void* data, int sizeInBytes) override;
 
+    // fixes the delay modulation's random sequence, so offline renders are reproducible
+    void setRandomSeed(juce::int64 seed);
+
+    // per block meters, connect a reader to start them
+    telemetry::Channel& getTelemetry() noexcept;
+
     juce::AudioProcessorValueTreeState::ParameterLayout createParameters();
     juce::AudioProcessorValueTreeState params{ *this, nullptr, "Parameters", createParameters() };
 
 
 private:
-    dsp::Delay delay;
+    automation::ParameterReader parameterReader{ params };
+
+    std::atomic<float>* qualityParameter{ params.getRawParameterValue("QUALITY") };
+    quality::Watchdog watchdog;
+
+    std::atomic<float>* offlineParallelParameter{ params.getRawParameterValue("OFFLINEPARALLEL") };
+
+    std::atomic<float>* autoGainParameter{ params.getRawParameterValue("AUTOGAIN") };
+    std::atomic<float>* targetLoudnessParameter{ params.getRawParameterValue("TARGETLUFS") };
+    bool wasAutoGain{ false };
+
+    dsp::Chain chain;
+
+    // State
+    // cached so saving and restoring never looks parameters up by id
+    std::array<juce::RangedAudioParameter*, state::numParameters> stateParameters;
+    std::array<std::atomic<float>*, state::numParameters> stateValues;
 
-    dsp::CutFilters cutFilters;
+    // odd while a state is being restored, the audio thread keeps the previous values until it is even again
+    std::atomic<unsigned int> stateGeneration{ 0 };
+    automation::ParameterSnapshot previousSnapshot;
 
-    dsp::Compressor compressor;
+    void applyState(const state::Values& values);
 
-    juce::Random random;
+    quality::Tier getTier() const;
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (UltiknobAudioProcessor)
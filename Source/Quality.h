@@ -0,0 +1,139 @@
+#pragma once
+#include "Utils.h"
+
+namespace quality
+{
+	enum class Tier
+	{
+		Eco,
+		Standard,
+		High
+	};
+
+	enum class Interpolation
+	{
+		Linear,
+		Cubic
+	};
+
+	enum class FilterTopology
+	{
+		DirectForm,
+		TopologyPreserving
+	};
+
+	struct Settings
+	{
+		Interpolation interpolation;
+		FilterTopology filterTopology;
+		bool oversampledCompressor;
+		bool antialiasedSaturation;
+	};
+
+	/*
+	* Eco: the original algorithms and a plain tanh for the dirty drive, cheapest
+	* Standard: cubic delay interpolation, TPT cut filters, which stay clean under fast modulation, and ADAA drive
+	* High: Standard plus a 2x oversampled compressor, so the detector also catches inter-sample peaks
+	*/
+	inline Settings settingsForTier(Tier tier) noexcept
+	{
+		switch (tier)
+		{
+		case Tier::Eco:
+			return { Interpolation::Linear, FilterTopology::DirectForm, false, false };
+		case Tier::Standard:
+			return { Interpolation::Cubic, FilterTopology::TopologyPreserving, false, true };
+		case Tier::High:
+		default:
+			return { Interpolation::Cubic, FilterTopology::TopologyPreserving, true, true };
+		}
+	}
+
+	/*
+	* measures every processBlock against its real-time budget (numSamples / sampleRate)
+	* and limits the tier when an instance keeps eating too much of the audio callback
+	* once the load has stayed low for a while the limit is raised again, one tier at a time
+	*/
+	struct Watchdog
+	{
+		static constexpr float stepDownLoad = .5f;
+		static constexpr float stepUpLoad = .15f;
+		static constexpr double stepDownAfterSecs = .25;
+		static constexpr double stepUpAfterSecs = 5.;
+
+		Watchdog() :
+			sampleRate(44100.),
+			smoothedLoad(0.f),
+			overloadedSecs(0.),
+			idleSecs(0.),
+			limit(Tier::High)
+		{}
+
+		struct ScopedMeasurement
+		{
+			ScopedMeasurement(Watchdog& _watchdog, int _numSamples, bool _isActive) :
+				watchdog(_watchdog),
+				startTicks(juce::Time::getHighResolutionTicks()),
+				numSamples(_numSamples),
+				isActive(_isActive)
+			{}
+			~ScopedMeasurement()
+			{
+				if (isActive)
+					watchdog.measure(juce::Time::getHighResolutionTicks() - startTicks, numSamples);
+			}
+
+		private:
+			Watchdog& watchdog;
+			const juce::int64 startTicks;
+			const int numSamples;
+			const bool isActive;
+		};
+
+		void prepare(double _sampleRate)
+		{
+			sampleRate = _sampleRate;
+			smoothedLoad = 0.f;
+			overloadedSecs = 0.;
+			idleSecs = 0.;
+		}
+
+		Tier operator()(Tier requested) const noexcept
+		{
+			return static_cast<int>(requested) < static_cast<int>(limit) ? requested : limit;
+		}
+
+		float getLoad() const noexcept { return smoothedLoad; }
+
+	protected:
+		double sampleRate;
+		float smoothedLoad;
+		double overloadedSecs, idleSecs;
+		Tier limit;
+
+		void measure(juce::int64 elapsedTicks, int numSamples) noexcept
+		{
+			if (numSamples <= 0)
+				return;
+
+			const auto budgetSecs = static_cast<double>(numSamples) / sampleRate;
+			const auto load = static_cast<float>(juce::Time::highResolutionTicksToSeconds(elapsedTicks) / budgetSecs);
+			smoothedLoad += .2f * (load - smoothedLoad);
+
+			overloadedSecs = smoothedLoad > stepDownLoad ? overloadedSecs + budgetSecs : 0.;
+			idleSecs = smoothedLoad < stepUpLoad ? idleSecs + budgetSecs : 0.;
+
+			if (overloadedSecs > stepDownAfterSecs && limit != Tier::Eco)
+			{
+				limit = static_cast<Tier>(static_cast<int>(limit) - 1);
+				overloadedSecs = 0.;
+				smoothedLoad = 0.f;
+			}
+			else if (idleSecs > stepUpAfterSecs && limit != Tier::High)
+			{
+				limit = static_cast<Tier>(static_cast<int>(limit) + 1);
+				idleSecs = 0.;
+			}
+		}
+	};
+}
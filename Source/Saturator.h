@@ -0,0 +1,241 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "Utils.h"
+
+namespace dsp
+{
+	/*
+	* tanh drive stage for dirty mode
+	* antialiased with first order antiderivative anti-aliasing (ADAA) instead of oversampling:
+	* the output is the slope of the antiderivative between two input samples,
+	* which acts like a lowpass on the harmonics the waveshaper creates
+	* everything runs in float on whole blocks, as short loops without branches the compiler vectorises
+	*/
+	struct Saturator
+	{
+		static constexpr int maxChannels = 2;
+
+		// below this input step the slope loses too many float digits, the tanh of the midpoint is used instead
+		static constexpr float tolerance = 1.e-2f;
+
+		// exp(-2 * 40) is far below float resolution next to 1, larger inputs only need their sign
+		static constexpr float maxMagnitude = 40.f;
+
+		Saturator() :
+			drive(1.f),
+			isAntialiased(true),
+			crossfade(),
+			crossfadeGains(),
+			isFading(false),
+			isSeeded(),
+			previousInput(),
+			previousAntiderivative(),
+			inputs(),
+			antiderivatives(),
+			midpoints(),
+			previousPaths()
+		{
+			isSeeded.fill(false);
+			previousInput.fill(0.f);
+			previousAntiderivative.fill(0.f);
+		}
+
+		void prepare(double sampleRate, int blockSize)
+		{
+			crossfade.prepare(static_cast<int>(sampleRate * .02));
+			crossfadeGains.resize(blockSize);
+
+			for (auto channel = 0; channel < maxChannels; ++channel)
+			{
+				inputs[channel].resize(blockSize);
+				antiderivatives[channel].resize(blockSize);
+				midpoints[channel].resize(blockSize);
+				previousPaths[channel].resize(blockSize);
+			}
+
+			reset();
+		}
+
+		void reset() noexcept
+		{
+			previousInput.fill(0.f);
+			previousAntiderivative.fill(0.f);
+			isSeeded.fill(false);
+			crossfade.finish();
+		}
+
+		// the waveshapers differ in level and by half a sample of delay, so switching crossfades them
+		void setAntialiasing(bool _isAntialiased) noexcept
+		{
+			if (_isAntialiased == isAntialiased)
+				return;
+
+			isAntialiased = _isAntialiased;
+			crossfade.start();
+		}
+
+		void updateParameters(float driveInDb)
+		{
+			drive = juce::Decibels::decibelsToGain(driveInDb);
+		}
+
+		void processBlock(float** samples, int numChannels, int numSamples)
+		{
+			prepareBlock(numSamples);
+
+			for (auto channel = 0; channel < numChannels; ++channel)
+				processChannel(channel, samples[channel], numSamples);
+		}
+
+		// advances the crossfade all channels share, call once per block before processChannel
+		void prepareBlock(int numSamples) noexcept
+		{
+			isFading = crossfade.isActive();
+			if (isFading)
+				crossfade(crossfadeGains.data(), numSamples);
+		}
+
+		// a channel only touches its own state and scratch buffers, so channels can run on different threads
+		void processChannel(int channel, float* samplesSingleChannel, int numSamples) noexcept
+		{
+			if (numSamples <= 0)
+				return;
+
+			auto input = inputs[channel].data();
+			juce::FloatVectorOperations::copyWithMultiply(input, samplesSingleChannel, drive, numSamples);
+
+			if (!isFading)
+			{
+				if (isAntialiased)
+					processAntialiased(channel, input, samplesSingleChannel, numSamples);
+				else
+					processPlain(channel, input, samplesSingleChannel, numSamples);
+			}
+			else
+			{
+				// while switching, both run on the same input, which also keeps the antiderivative seeded
+				auto previousPath = previousPaths[channel].data();
+				processAntialiased(channel, input, isAntialiased ? samplesSingleChannel : previousPath, numSamples);
+				tanh(isAntialiased ? previousPath : samplesSingleChannel, input, numSamples);
+				utils::Crossfade::mix(samplesSingleChannel, previousPath, crossfadeGains.data(), numSamples);
+			}
+
+			juce::FloatVectorOperations::multiply(samplesSingleChannel, 1.f / drive, numSamples);
+		}
+
+		// call for every block the saturator is bypassed in
+		void bypass() noexcept
+		{
+			isSeeded.fill(false);
+			crossfade.finish();
+		}
+
+	protected:
+		float drive;
+		bool isAntialiased;
+		utils::Crossfade crossfade;
+		std::vector<float> crossfadeGains;
+		bool isFading;
+		std::array<bool, maxChannels> isSeeded;
+		std::array<float, maxChannels> previousInput, previousAntiderivative;
+		std::array<std::vector<float>, maxChannels> inputs, antiderivatives, midpoints, previousPaths;
+
+		// the plain waveshaper does not track the antiderivative, so it is seeded again once ADAA takes over
+		void processPlain(int channel, const float* input, float* output, int numSamples) noexcept
+		{
+			isSeeded[channel] = false;
+			tanh(output, input, numSamples);
+		}
+
+		// output must not alias input
+		void processAntialiased(int channel, const float* input, float* output, int numSamples) noexcept
+		{
+			// coming out of bypass the previous sample is the current one, so the first slope is not taken from stale state
+			if (!isSeeded[channel])
+			{
+				previousInput[channel] = input[0];
+				logCosh(&previousAntiderivative[channel], input, 1);
+				isSeeded[channel] = true;
+			}
+
+			auto antiderivative = antiderivatives[channel].data();
+			auto midpoint = midpoints[channel].data();
+			logCosh(antiderivative, input, numSamples);
+
+			midpoint[0] = .5f * (input[0] + previousInput[channel]);
+			for (auto sample = 1; sample < numSamples; ++sample)
+				midpoint[sample] = .5f * (input[sample] + input[sample - 1]);
+			tanh(output, midpoint, numSamples);
+
+			// blended instead of branched, for (nearly) equal inputs the weight keeps the midpoint
+			auto slope = [output](int sample, float difference, float antiderivativeDifference)
+			{
+				const auto weight = std::abs(difference) > tolerance ? 1.f : 0.f;
+				const auto safeDifference = difference + (1.f - weight);
+				output[sample] += weight * (antiderivativeDifference / safeDifference - output[sample]);
+			};
+
+			slope(0, input[0] - previousInput[channel], antiderivative[0] - previousAntiderivative[channel]);
+			for (auto sample = 1; sample < numSamples; ++sample)
+				slope(sample, input[sample] - input[sample - 1], antiderivative[sample] - antiderivative[sample - 1]);
+
+			previousInput[channel] = input[numSamples - 1];
+			previousAntiderivative[channel] = antiderivative[numSamples - 1];
+		}
+
+		// exp(-2a) for a in [0, maxMagnitude], relative error about 1e-7
+		static float expOfMinusTwice(float a) noexcept
+		{
+			// 2^v = 2^exponent * 2^t, the fraction is taken from v itself so it keeps all of v's digits
+			const auto v = -2.88539008f * a;
+			const auto exponent = static_cast<std::int32_t>(v + 127.f);
+			const auto t = v - static_cast<float>(exponent - 127);
+
+			const auto p = 1.f + t * (.693146933f + t * (.240230454f + t * (.0554806302f + t * (.00968418631f + t * (.00123913318f + t * .000218657848f)))));
+
+			const std::int32_t bits = exponent << 23;
+			float scale;
+			std::memcpy(&scale, &bits, sizeof(scale));
+			return scale * p;
+		}
+
+		// log(1 + t) for t in [0, 1], absolute error below 2e-8 before rounding
+		static float logOnePlus(float t) noexcept
+		{
+			return t * (.999999966f + t * (-.49999445f + t * (.333181217f + t * (-.24835399f + t * (.190768807f
+				+ t * (-.136022476f + t * (.0775160866f + t * (-.0290740646f + t * .00512610212f))))))));
+		}
+
+		/*
+		* antiderivative of tanh: log(cosh(x)) = |x| - log(2) + log(1 + exp(-2|x|)), which does not overflow
+		* split into separate loops, a clamp and a float to int conversion in the same loop keep it from vectorising
+		*/
+		static void logCosh(float* destination, const float* source, int numSamples) noexcept
+		{
+			for (auto sample = 0; sample < numSamples; ++sample)
+				destination[sample] = std::min(std::abs(source[sample]), maxMagnitude);
+			for (auto sample = 0; sample < numSamples; ++sample)
+				destination[sample] = logOnePlus(expOfMinusTwice(destination[sample]));
+			for (auto sample = 0; sample < numSamples; ++sample)
+				destination[sample] += std::abs(source[sample]) - .693147181f;
+		}
+
+		// tanh(x) = sign(x) * (1 - exp(-2|x|)) / (1 + exp(-2|x|)), destination must not alias source
+		static void tanh(float* destination, const float* source, int numSamples) noexcept
+		{
+			for (auto sample = 0; sample < numSamples; ++sample)
+				destination[sample] = std::min(std::abs(source[sample]), maxMagnitude);
+			for (auto sample = 0; sample < numSamples; ++sample)
+			{
+				const auto e = expOfMinusTwice(destination[sample]);
+				destination[sample] = (1.f - e) / (1.f + e);
+			}
+			for (auto sample = 0; sample < numSamples; ++sample)
+				destination[sample] = std::copysign(destination[sample], source[sample]);
+		}
+	};
+}
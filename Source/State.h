@@ -0,0 +1,182 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <JuceHeader.h>
+
+namespace state
+{
+	/*
+	* every parameter in the order it is stored
+	* new parameters are only ever appended, together with a version bump and an entry in numValuesInVersion
+	*/
+	static constexpr int numParameters = 18;
+	static constexpr std::array<const char*, numParameters> parameterIds{
+		"PERCENTAGE",
+		"DIRTYMODE",
+		"DELAYTIME",
+		"LOWCUT",
+		"HIGHCUT",
+		"RATIO",
+		"THRESHOLD",
+		"ATTACK",
+		"RELEASE",
+		"INPUTGAIN",
+		"OUTPUTGAIN",
+		"DRIVE",
+		"MULTIBAND",
+		"QUALITY",
+		"OFFLINEPARALLEL",
+		// version 2
+		"AUTOGAIN",
+		"TARGETLUFS",
+		// version 3
+		"TAPS"
+	};
+
+	// plain (denormalised) values, indexed like parameterIds
+	using Values = std::array<float, numParameters>;
+
+	static constexpr std::uint32_t magic = 0x54534b55; // "UKST"
+	static constexpr std::uint16_t currentVersion = 3;
+
+	// how many of parameterIds each version stores, indexed by version
+	static constexpr std::array<int, currentVersion + 1> numValuesInVersion{
+		0,	// no version 0 was ever written
+		15,
+		17,
+		18
+	};
+	static_assert(numValuesInVersion[currentVersion] == numParameters, "bump currentVersion when appending parameters");
+
+	struct Header
+	{
+		std::uint32_t magic;
+		std::uint16_t version;
+		std::uint16_t numValues;
+	};
+
+	/*
+	* the stored state: header, numValues floats and an fnv-1a checksum over everything before it
+	* all fields are little endian
+	*/
+	struct Blob
+	{
+		Header header;
+		Values values;
+		std::uint32_t checksum;
+	};
+	static_assert(std::is_trivially_copyable<Blob>::value, "the blob is copied as raw bytes");
+	static_assert(sizeof(Blob) == sizeof(Header) + sizeof(Values) + sizeof(std::uint32_t), "the blob must not be padded");
+
+	inline std::uint32_t checksum(const void* data, size_t numBytes) noexcept
+	{
+		auto hash = static_cast<std::uint32_t>(2166136261u);
+		const auto bytes = static_cast<const std::uint8_t*>(data);
+		for (size_t i = 0; i < numBytes; ++i)
+			hash = (hash ^ bytes[i]) * 16777619u;
+		return hash;
+	}
+
+	inline std::uint32_t floatToLittleEndian(float value) noexcept
+	{
+		std::uint32_t bits;
+		std::memcpy(&bits, &value, sizeof(bits));
+		return juce::ByteOrder::swapIfBigEndian(bits);
+	}
+
+	inline float floatFromLittleEndian(std::uint32_t bits) noexcept
+	{
+		bits = juce::ByteOrder::swapIfBigEndian(bits);
+		float value;
+		std::memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+
+	inline void write(const Values& values, juce::MemoryBlock& destData)
+	{
+		Blob blob;
+		blob.header.magic = juce::ByteOrder::swapIfBigEndian(magic);
+		blob.header.version = juce::ByteOrder::swapIfBigEndian(currentVersion);
+		blob.header.numValues = juce::ByteOrder::swapIfBigEndian(static_cast<std::uint16_t>(numParameters));
+
+		for (auto i = 0; i < numParameters; ++i)
+		{
+			const auto bits = floatToLittleEndian(values[i]);
+			std::memcpy(&blob.values[i], &bits, sizeof(bits));
+		}
+
+		blob.checksum = juce::ByteOrder::swapIfBigEndian(checksum(&blob, offsetof(Blob, checksum)));
+		destData.replaceWith(&blob, sizeof(blob));
+	}
+
+	// true if the data starts like a binary state, anything else is treated as an older ValueTree blob
+	inline bool isBinary(const void* data, int sizeInBytes) noexcept
+	{
+		if (data == nullptr || sizeInBytes < static_cast<int>(sizeof(Header)))
+			return false;
+
+		std::uint32_t storedMagic;
+		std::memcpy(&storedMagic, data, sizeof(storedMagic));
+		return juce::ByteOrder::swapIfBigEndian(storedMagic) == magic;
+	}
+
+	/*
+	* overwrites the values the blob holds and leaves the others untouched, so the caller fills in defaults first
+	* that is the whole migration from older versions: parameters are only appended, the new ones keep their defaults
+	* returns false, without touching values, for truncated or corrupted data and for versions this build does not know
+	*/
+	inline bool read(const void* data, int sizeInBytes, Values& values) noexcept
+	{
+		if (!isBinary(data, sizeInBytes))
+			return false;
+
+		Header header;
+		std::memcpy(&header, data, sizeof(header));
+		const auto version = juce::ByteOrder::swapIfBigEndian(header.version);
+		const auto numValues = static_cast<int>(juce::ByteOrder::swapIfBigEndian(header.numValues));
+
+		// a newer version may have changed what existing values mean, so it is not guessed at
+		if (version == 0 || version > currentVersion || numValues != numValuesInVersion[version])
+			return false;
+
+		const auto checkedBytes = sizeof(Header) + static_cast<size_t>(numValues) * sizeof(float);
+		if (static_cast<size_t>(sizeInBytes) < checkedBytes + sizeof(std::uint32_t))
+			return false;
+
+		const auto bytes = static_cast<const std::uint8_t*>(data);
+		std::uint32_t storedChecksum;
+		std::memcpy(&storedChecksum, bytes + checkedBytes, sizeof(storedChecksum));
+		if (juce::ByteOrder::swapIfBigEndian(storedChecksum) != checksum(data, checkedBytes))
+			return false;
+
+		for (auto i = 0; i < numValues; ++i)
+		{
+			std::uint32_t bits;
+			std::memcpy(&bits, bytes + sizeof(Header) + static_cast<size_t>(i) * sizeof(float), sizeof(bits));
+			values[i] = floatFromLittleEndian(bits);
+		}
+		return true;
+	}
+
+	/*
+	* migration from the blobs written before the binary format: the plain AudioProcessorValueTreeState tree
+	* parameters missing from the tree keep the values passed in
+	*/
+	inline bool readValueTree(const void* data, int sizeInBytes, const juce::Identifier& stateType, Values& values)
+	{
+		const auto tree = juce::ValueTree::readFromData(data, static_cast<size_t>(sizeInBytes));
+		if (!tree.isValid() || !tree.hasType(stateType))
+			return false;
+
+		for (auto i = 0; i < numParameters; ++i)
+		{
+			const auto parameter = tree.getChildWithProperty("id", parameterIds[i]);
+			if (parameter.isValid())
+				values[i] = static_cast<float>(parameter.getProperty("value", values[i]));
+		}
+		return true;
+	}
+}
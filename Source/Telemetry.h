@@ -0,0 +1,148 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include "Utils.h"
+#include "Loudness.h"
+
+namespace telemetry
+{
+	/*
+	* what the chain reports once per processBlock, levels are linear, the rest is in dB, ms and LUFS
+	* the loudness is measured before OUTPUTGAIN and the auto gain, see Chain::getLoudness
+	*/
+	struct Frame
+	{
+		float inputPeak = 0.f;
+		float inputRms = 0.f;
+		float outputPeak = 0.f;
+		float outputRms = 0.f;
+		float gainReduction = 0.f;
+		float delayTime = 0.f;
+		float momentaryLoudness = loudness::silence;
+		float shortTermLoudness = loudness::silence;
+		float integratedLoudness = loudness::silence;
+	};
+
+	struct Level
+	{
+		float peak = 0.f;
+		float rms = 0.f;
+	};
+
+	inline Level measure(const float* const* samples, int numChannels, int numSamples) noexcept
+	{
+		Level level;
+		if (numChannels <= 0 || numSamples <= 0)
+			return level;
+
+		auto sumOfSquares = 0.f;
+		for (auto channel = 0; channel < numChannels; ++channel)
+		{
+			const auto range = juce::FloatVectorOperations::findMinAndMax(samples[channel], numSamples);
+			level.peak = juce::jmax(level.peak, -range.getStart(), range.getEnd());
+			sumOfSquares += utils::sumOfSquares(samples[channel], numSamples);
+		}
+		level.rms = std::sqrt(sumOfSquares / static_cast<float>(numChannels * numSamples));
+		return level;
+	}
+
+	/*
+	* wait-free single producer, single consumer ring
+	* the producer never blocks: when the consumer falls behind, new items are dropped
+	*/
+	template<typename T, int capacity>
+	struct SpscRing
+	{
+		static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+		SpscRing() :
+			items(),
+			writeIndex(0),
+			readIndex(0)
+		{}
+
+		bool push(const T& item) noexcept
+		{
+			const auto write = writeIndex.load(std::memory_order_relaxed);
+			if (write - readIndex.load(std::memory_order_acquire) == capacity)
+				return false;
+
+			items[write & mask] = item;
+			writeIndex.store(write + 1, std::memory_order_release);
+			return true;
+		}
+
+		bool pop(T& item) noexcept
+		{
+			const auto read = readIndex.load(std::memory_order_relaxed);
+			if (read == writeIndex.load(std::memory_order_acquire))
+				return false;
+
+			item = items[read & mask];
+			readIndex.store(read + 1, std::memory_order_release);
+			return true;
+		}
+
+	protected:
+		static constexpr std::uint32_t mask = capacity - 1;
+
+		std::array<T, capacity> items;
+		// producer and consumer indices live on their own cache lines
+		alignas(64) std::atomic<std::uint32_t> writeIndex;
+		alignas(64) std::atomic<std::uint32_t> readIndex;
+	};
+
+	/*
+	* the audio thread publishes, one reader (editor timer, command line tool) connects and drains
+	* the producer checks isConnected once per block and skips all metering while nobody listens
+	*/
+	struct Channel
+	{
+		// plenty for 32 sample blocks read at 30 Hz
+		static constexpr int capacity = 2'048;
+
+		Channel() :
+			ring(),
+			connected(false)
+		{}
+
+		// audio thread
+
+		bool isConnected() const noexcept
+		{
+			return connected.load(std::memory_order_relaxed);
+		}
+
+		void publish(const Frame& frame) noexcept
+		{
+			ring.push(frame);
+		}
+
+		// reader thread
+
+		void connect() noexcept
+		{
+			// frames left over from an earlier reader are stale
+			Frame stale;
+			while (ring.pop(stale)) {}
+
+			connected.store(true, std::memory_order_relaxed);
+		}
+
+		void disconnect() noexcept
+		{
+			connected.store(false, std::memory_order_relaxed);
+		}
+
+		bool read(Frame& frame) noexcept
+		{
+			return ring.pop(frame);
+		}
+
+	protected:
+		SpscRing<Frame, capacity> ring;
+		std::atomic<bool> connected;
+	};
+}
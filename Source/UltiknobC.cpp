@@ -0,0 +1,236 @@
+/*
+  ==============================================================================
+
+    Plain C interface to the Ultiknob processing chain.
+
+  ==============================================================================
+*/
+
+#include "UltiknobC.h"
+#include "Chain.h"
+#include "Macro.h"
+#include <new>
+
+namespace
+{
+    struct Range
+    {
+        float minimum;
+        float maximum;
+    };
+
+    // same ranges as UltiknobAudioProcessor::createParameters
+    constexpr Range ranges[ULTIKNOB_NUM_PARAMETERS]{
+        { 20.f, 80.f },         // LOWCUT
+        { 8000.f, 20000.f },    // HIGHCUT
+        { 0.f, 40.f },          // DELAYTIME
+        { 1.f, 10.f },          // RATIO
+        { -36.f, 0.f },         // THRESHOLD
+        { -24.f, 24.f },        // INPUTGAIN
+        { -24.f, 24.f },        // OUTPUTGAIN
+        { 0.f, 24.f },          // DRIVE
+        { 0.f, 1.f },           // DIRTYMODE
+        { 0.f, 1.f },           // MULTIBAND
+        { 0.f, 2.f },           // QUALITY
+        { 1.f, 4.f }            // TAPS
+    };
+
+    bool isValid(UltiknobParameter parameter) noexcept
+    {
+        return parameter >= 0 && parameter < ULTIKNOB_NUM_PARAMETERS;
+    }
+}
+
+struct UltiknobInstance
+{
+    dsp::Chain chain;
+    automation::ParameterSnapshot snapshot;
+    quality::Tier tier{ quality::Tier::Standard };
+
+    // planar scratch space for interleaved processing, sized in prepare
+    juce::AudioBuffer<float> scratch;
+    int maxBlockSize{ 0 };
+    int numChannels{ 0 };
+
+    void process(float** channels, int numChannelsToProcess, int numSamples)
+    {
+        chain.setQuality(tier);
+        chain.processBlock(channels, numChannelsToProcess, numSamples, snapshot);
+    }
+};
+
+UltiknobInstance* ultiknob_create(void)
+{
+    try
+    {
+        return new UltiknobInstance();
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void ultiknob_destroy(UltiknobInstance* instance)
+{
+    delete instance;
+}
+
+UltiknobResult ultiknob_prepare(UltiknobInstance* instance, double sampleRate, int maxBlockSize, int numChannels)
+{
+    if (instance == nullptr || sampleRate <= 0. || maxBlockSize <= 0
+        || numChannels < 1 || numChannels > dsp::Chain::maxChannels)
+        return ULTIKNOB_INVALID_ARGUMENT;
+
+    try
+    {
+        instance->chain.prepare(sampleRate, maxBlockSize, instance->snapshot);
+        instance->scratch.setSize(numChannels, maxBlockSize, false, false, true);
+    }
+    catch (const std::bad_alloc&)
+    {
+        instance->maxBlockSize = 0;
+        return ULTIKNOB_OUT_OF_MEMORY;
+    }
+    catch (...)
+    {
+        // nothing may escape into a C caller
+        instance->maxBlockSize = 0;
+        return ULTIKNOB_INTERNAL_ERROR;
+    }
+
+    instance->maxBlockSize = maxBlockSize;
+    instance->numChannels = numChannels;
+    return ULTIKNOB_OK;
+}
+
+UltiknobResult ultiknob_set_parameter(UltiknobInstance* instance, UltiknobParameter parameter, float value)
+{
+    if (instance == nullptr || !isValid(parameter))
+        return ULTIKNOB_INVALID_ARGUMENT;
+
+    value = juce::jlimit(ranges[parameter].minimum, ranges[parameter].maximum, value);
+    auto& snapshot = instance->snapshot;
+
+    switch (parameter)
+    {
+    case ULTIKNOB_LOWCUT:       snapshot.lowCut = value; break;
+    case ULTIKNOB_HIGHCUT:      snapshot.highCut = value; break;
+    case ULTIKNOB_DELAYTIME:    snapshot.delayTime = value; break;
+    case ULTIKNOB_RATIO:        snapshot.ratio = value; break;
+    case ULTIKNOB_THRESHOLD:    snapshot.threshold = value; break;
+    case ULTIKNOB_INPUTGAIN:    snapshot.inputGain = value; break;
+    case ULTIKNOB_OUTPUTGAIN:   snapshot.outputGain = value; break;
+    case ULTIKNOB_DRIVE:        snapshot.drive = value; break;
+    case ULTIKNOB_DIRTYMODE:    snapshot.isDirty = value >= .5f; break;
+    case ULTIKNOB_MULTIBAND:    snapshot.isMultiband = value >= .5f; break;
+    case ULTIKNOB_QUALITY:      instance->tier = static_cast<quality::Tier>(juce::roundToInt(value)); break;
+    case ULTIKNOB_TAPS:         snapshot.numTaps = juce::roundToInt(value); break;
+    default:                    return ULTIKNOB_INVALID_ARGUMENT;
+    }
+    return ULTIKNOB_OK;
+}
+
+float ultiknob_get_parameter(const UltiknobInstance* instance, UltiknobParameter parameter)
+{
+    if (instance == nullptr || !isValid(parameter))
+        return 0.f;
+
+    const auto& snapshot = instance->snapshot;
+
+    switch (parameter)
+    {
+    case ULTIKNOB_LOWCUT:       return snapshot.lowCut;
+    case ULTIKNOB_HIGHCUT:      return snapshot.highCut;
+    case ULTIKNOB_DELAYTIME:    return snapshot.delayTime;
+    case ULTIKNOB_RATIO:        return snapshot.ratio;
+    case ULTIKNOB_THRESHOLD:    return snapshot.threshold;
+    case ULTIKNOB_INPUTGAIN:    return snapshot.inputGain;
+    case ULTIKNOB_OUTPUTGAIN:   return snapshot.outputGain;
+    case ULTIKNOB_DRIVE:        return snapshot.drive;
+    case ULTIKNOB_DIRTYMODE:    return snapshot.isDirty ? 1.f : 0.f;
+    case ULTIKNOB_MULTIBAND:    return snapshot.isMultiband ? 1.f : 0.f;
+    case ULTIKNOB_QUALITY:      return static_cast<float>(instance->tier);
+    case ULTIKNOB_TAPS:         return static_cast<float>(snapshot.numTaps);
+    default:                    return 0.f;
+    }
+}
+
+UltiknobResult ultiknob_set_macro(UltiknobInstance* instance, float percentage)
+{
+    if (instance == nullptr)
+        return ULTIKNOB_INVALID_ARGUMENT;
+
+    const auto values = macro::map(juce::jlimit(0.f, 100.f, percentage), instance->snapshot.isDirty);
+
+    auto& snapshot = instance->snapshot;
+    snapshot.delayTime = values.delayTime;
+    snapshot.ratio = values.ratio;
+    snapshot.drive = values.drive;
+    snapshot.lowCut = values.lowCut;
+    snapshot.highCut = values.highCut;
+    return ULTIKNOB_OK;
+}
+
+void ultiknob_set_seed(UltiknobInstance* instance, int64_t seed)
+{
+    if (instance != nullptr)
+        instance->chain.setRandomSeed(static_cast<juce::int64>(seed));
+}
+
+UltiknobResult ultiknob_process_planar(UltiknobInstance* instance, float* const* channels, int numChannels, int numSamples)
+{
+    if (instance == nullptr || channels == nullptr || numSamples < 0)
+        return ULTIKNOB_INVALID_ARGUMENT;
+    if (instance->maxBlockSize == 0)
+        return ULTIKNOB_NOT_PREPARED;
+    if (numChannels < 1 || numChannels > instance->numChannels)
+        return ULTIKNOB_INVALID_ARGUMENT;
+
+    for (auto start = 0; start < numSamples; start += instance->maxBlockSize)
+    {
+        const auto length = juce::jmin(instance->maxBlockSize, numSamples - start);
+
+        float* chunk[dsp::Chain::maxChannels]{ nullptr, nullptr };
+        for (auto channel = 0; channel < numChannels; ++channel)
+            chunk[channel] = channels[channel] + start;
+
+        instance->process(chunk, numChannels, length);
+    }
+    return ULTIKNOB_OK;
+}
+
+UltiknobResult ultiknob_process_interleaved(UltiknobInstance* instance, float* samples, int numChannels, int numFrames)
+{
+    if (instance == nullptr || samples == nullptr || numFrames < 0)
+        return ULTIKNOB_INVALID_ARGUMENT;
+    if (instance->maxBlockSize == 0)
+        return ULTIKNOB_NOT_PREPARED;
+    if (numChannels < 1 || numChannels > instance->numChannels)
+        return ULTIKNOB_INVALID_ARGUMENT;
+
+    auto planar = instance->scratch.getArrayOfWritePointers();
+
+    for (auto start = 0; start < numFrames; start += instance->maxBlockSize)
+    {
+        const auto length = juce::jmin(instance->maxBlockSize, numFrames - start);
+        auto interleaved = samples + static_cast<size_t>(start) * static_cast<size_t>(numChannels);
+
+        for (auto frame = 0; frame < length; ++frame)
+            for (auto channel = 0; channel < numChannels; ++channel)
+                planar[channel][frame] = interleaved[frame * numChannels + channel];
+
+        instance->process(planar, numChannels, length);
+
+        for (auto frame = 0; frame < length; ++frame)
+            for (auto channel = 0; channel < numChannels; ++channel)
+                interleaved[frame * numChannels + channel] = planar[channel][frame];
+    }
+    return ULTIKNOB_OK;
+}
+
+void ultiknob_reset(UltiknobInstance* instance)
+{
+    if (instance != nullptr && instance->maxBlockSize != 0)
+        instance->chain.reset(instance->snapshot);
+}
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    Plain C interface to the Ultiknob processing chain, for embedding it
+    without a plugin host, a message thread or the plugin binary.
+
+    - every instance is independent: use one instance per thread
+    - ultiknob_prepare allocates, nothing else does (apart from create)
+    - blocks of any length may be processed, they are split internally
+      into chunks of at most maxBlockSize samples
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct UltiknobInstance UltiknobInstance;
+
+typedef enum UltiknobParameter
+{
+    ULTIKNOB_LOWCUT = 0,     /* Hz, 20 - 80 */
+    ULTIKNOB_HIGHCUT,        /* Hz, 8000 - 20000 */
+    ULTIKNOB_DELAYTIME,      /* ms, 0 - 40 */
+    ULTIKNOB_RATIO,          /* 1 - 10 */
+    ULTIKNOB_THRESHOLD,      /* dB, -36 - 0 */
+    ULTIKNOB_INPUTGAIN,      /* dB, -24 - 24 */
+    ULTIKNOB_OUTPUTGAIN,     /* dB, -24 - 24 */
+    ULTIKNOB_DRIVE,          /* dB, 0 - 24 */
+    ULTIKNOB_DIRTYMODE,      /* 0 or 1 */
+    ULTIKNOB_MULTIBAND,      /* 0 or 1 */
+    ULTIKNOB_QUALITY,        /* 0 = eco, 1 = standard, 2 = high */
+    ULTIKNOB_TAPS,           /* 1 - 4, more than 1 adds ensemble voices to the delay */
+    ULTIKNOB_NUM_PARAMETERS
+} UltiknobParameter;
+
+typedef enum UltiknobResult
+{
+    ULTIKNOB_OK = 0,
+    ULTIKNOB_INVALID_ARGUMENT,
+    ULTIKNOB_NOT_PREPARED,
+    ULTIKNOB_OUT_OF_MEMORY,
+    ULTIKNOB_INTERNAL_ERROR     /* any other failure, the instance is left unprepared */
+} UltiknobResult;
+
+UltiknobInstance* ultiknob_create(void);
+void ultiknob_destroy(UltiknobInstance* instance);
+
+/* numChannels is 1 or 2, preparing again at the same sample rate keeps all state (see ultiknob_reset) */
+UltiknobResult ultiknob_prepare(UltiknobInstance* instance, double sampleRate, int maxBlockSize, int numChannels);
+
+/* values are clamped to the ranges listed above, changes are ramped over the next block */
+UltiknobResult ultiknob_set_parameter(UltiknobInstance* instance, UltiknobParameter parameter, float value);
+float ultiknob_get_parameter(const UltiknobInstance* instance, UltiknobParameter parameter);
+
+/* sets everything the plugin's big knob drives, percentage 0 - 100, using the current dirty mode */
+UltiknobResult ultiknob_set_macro(UltiknobInstance* instance, float percentage);
+
+/* the delay modulation is random, a fixed seed makes renders reproducible */
+void ultiknob_set_seed(UltiknobInstance* instance, int64_t seed);
+
+UltiknobResult ultiknob_process_planar(UltiknobInstance* instance, float* const* channels, int numChannels, int numSamples);
+UltiknobResult ultiknob_process_interleaved(UltiknobInstance* instance, float* samples, int numChannels, int numFrames);
+
+/* clears all delay lines, filter and detector state, keeps the parameters */
+void ultiknob_reset(UltiknobInstance* instance);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,72 @@ namespace utils
 		return bufferChannel[floor] + fraction * (bufferChannel[ceiling] - bufferChannel[floor]);
 	}
 
+	// 4-point, 3rd-order hermite, reads one sample behind and two samples ahead of readPos
+	inline float cubicInterpolation(float* bufferChannel, float readPos, int bufferSize) noexcept
+	{
+		const auto readPosFloor = std::floor(readPos);
+		const auto floor = static_cast<int>(readPosFloor);
+		const auto fraction = readPos - readPosFloor;
+
+		const auto xm1 = bufferChannel[(floor - 1 + bufferSize) % bufferSize];
+		const auto x0 = bufferChannel[floor];
+		const auto x1 = bufferChannel[(floor + 1) % bufferSize];
+		const auto x2 = bufferChannel[(floor + 2) % bufferSize];
+
+		const auto c1 = .5f * (x1 - xm1);
+		const auto c2 = xm1 - 2.5f * x0 + 2.f * x1 - .5f * x2;
+		const auto c3 = .5f * (x2 - xm1) + 1.5f * (x0 - x1);
+		return ((c3 * fraction + c2) * fraction + c1) * fraction + x0;
+	}
+
+	inline float sumOfSquares(const float* samples, int numSamples) noexcept
+	{
+		auto sum = 0.f;
+		for (auto s = 0; s < numSamples; ++s)
+			sum += samples[s] * samples[s];
+		return sum;
+	}
+
+	/*
+	* linear crossfade used when a stage switches algorithm
+	* fills a buffer with the gain of the new path, the old path gets 1 - gain
+	*/
+	struct Crossfade
+	{
+		Crossfade() :
+			length(1),
+			position(1)
+		{}
+
+		void prepare(int lengthInSamples) noexcept
+		{
+			length = lengthInSamples > 0 ? lengthInSamples : 1;
+			position = length;
+		}
+		void start() noexcept { position = 0; }
+		void finish() noexcept { position = length; }
+		bool isActive() const noexcept { return position < length; }
+
+		void operator()(float* gains, int numSamples) noexcept
+		{
+			const auto increment = 1.f / static_cast<float>(length);
+			for (auto s = 0; s < numSamples; ++s)
+			{
+				gains[s] = position < length ? static_cast<float>(position) * increment : 1.f;
+				position = position < length ? position + 1 : length;
+			}
+		}
+
+		static void mix(float* newPath, const float* oldPath, const float* gains, int numSamples) noexcept
+		{
+			for (auto s = 0; s < numSamples; ++s)
+				newPath[s] = oldPath[s] + gains[s] * (newPath[s] - oldPath[s]);
+		}
+
+	protected:
+		int length, position;
+	};
+
 	// Many thanks to 'Beats basteln :3' on youtube!
 	struct Smooth
 	{
@@ -55,6 +121,10 @@ namespace utils
 			y1 = 0.f;
 			eps = 0.f;
 		}
+		void setCurrentValue(float val) noexcept
+		{
+			y1 = val;
+		}
 		void setX(float x) noexcept
 		{
 			a0 = 1.f - x;
@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    The batch renderer: a job renders the same whether its worker's
+    processor is fresh or already rendered other jobs.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "Tests.h"
+#include "../Source/BatchRenderer.h"
+#include <memory>
+
+namespace
+{
+    constexpr double sampleRate = 48'000.;
+    constexpr int blockSize = 512;
+
+    bool writeWav(const juce::File& file, const juce::AudioBuffer<float>& buffer)
+    {
+        file.deleteFile();
+        std::unique_ptr<juce::FileOutputStream> stream(file.createOutputStream());
+        if (stream == nullptr)
+            return false;
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(buffer.getNumChannels()), 32, {}, 0));
+        if (writer == nullptr)
+            return false;
+        stream.release(); // the writer owns the stream now
+
+        return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+    }
+
+    juce::AudioBuffer<float> readWav(const juce::File& file)
+    {
+        juce::AudioBuffer<float> buffer;
+        if (!file.existsAsFile())
+            return buffer;
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatReader> reader(wav.createReaderFor(file.createInputStream().release(), true));
+        if (reader != nullptr)
+        {
+            buffer.setSize(static_cast<int>(reader->numChannels), static_cast<int>(reader->lengthInSamples));
+            reader->read(&buffer, 0, buffer.getNumSamples(), 0, true, true);
+        }
+        return buffer;
+    }
+
+    // the state a preset with these parameters would store
+    juce::MemoryBlock makeState(const tests::Setup& setup)
+    {
+        UltiknobAudioProcessor processor;
+        tests::applyParameters(processor, setup);
+
+        juce::MemoryBlock state;
+        processor.getStateInformation(state);
+        return state;
+    }
+}
+
+//==============================================================================
+class BatchTest : public juce::UnitTest
+{
+public:
+    BatchTest() : juce::UnitTest("Batch renderer", "Batch") {}
+
+    void runTest() override
+    {
+        beginTest("a job renders the same on a fresh and on a reused processor");
+
+        const auto folder = juce::File::getSpecialLocation(juce::File::tempDirectory).getNonexistentChildFile("UltiknobBatchTest", {}, false);
+        folder.createDirectory();
+        const auto input = folder.getChildFile("input.wav");
+        const auto other = folder.getChildFile("other.wav");
+
+        auto otherSignal = tests::makeSignal(sampleRate, 1.);
+        otherSignal.reverse(0, otherSignal.getNumSamples());
+        expect(writeWav(input, tests::makeSignal(sampleRate, 1.5)) && writeWav(other, otherSignal), "cannot write the inputs");
+
+        // different presets, so the reused processor also has to leave the other job's settings behind
+        const auto dirtyState = makeState({ "dirty", { { "DIRTYMODE", 1.f }, { "MULTIBAND", 1.f }, { "DRIVE", 12.f }, { "RATIO", 8.f }, { "TAPS", 3.f } }, true });
+        const auto cleanState = makeState({ "clean", { { "DELAYTIME", 20.f }, { "RATIO", 2.f } }, true });
+
+        // one worker takes its jobs from the back, so the second renderer renders the other job first
+        juce::Array<BatchJob> freshJobs{ BatchJob{ input, folder.getChildFile("fresh.wav"), dirtyState } };
+        juce::Array<BatchJob> reusedJobs{
+            BatchJob{ input, folder.getChildFile("reused.wav"), dirtyState },
+            BatchJob{ other, folder.getChildFile("other_out.wav"), cleanState }
+        };
+
+        const auto freshReport = BatchRenderer(1, blockSize).render(freshJobs);
+        const auto reusedReport = BatchRenderer(1, blockSize).render(reusedJobs);
+        expectEquals(freshReport.numFailed + reusedReport.numFailed, 0, (freshReport.errors.joinIntoString(", ") + reusedReport.errors.joinIntoString(", ")));
+
+        const auto difference = tests::maxAbsoluteDifference(readWav(folder.getChildFile("fresh.wav")), readWav(folder.getChildFile("reused.wav")));
+        expect(difference == 0.f, "the reused processor is off by " + juce::String(difference));
+
+        folder.deleteRecursively();
+    }
+};
+
+static BatchTest batchTest;
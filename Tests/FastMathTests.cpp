@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+    The polynomial log2 and exp2 the gain computers use: their error against
+    libm over the ranges the compressor sees, and a benchmark against libm.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "Tests.h"
+#include "../Source/FastMath.h"
+#include <vector>
+
+namespace
+{
+    // log spaced from 1e-6 to 1e6, every gain a compressor sees and then some
+    std::vector<float> makeGains(int numValues)
+    {
+        std::vector<float> gains(static_cast<size_t>(numValues));
+        for (auto index = 0; index < numValues; ++index)
+            gains[static_cast<size_t>(index)] = static_cast<float>(std::pow(10., -6. + 12. * index / (numValues - 1)));
+        return gains;
+    }
+
+    // linearly spaced from -100 to 100 octaves
+    std::vector<float> makeOctaves(int numValues)
+    {
+        std::vector<float> octaves(static_cast<size_t>(numValues));
+        for (auto index = 0; index < numValues; ++index)
+            octaves[static_cast<size_t>(index)] = static_cast<float>(-100. + 200. * index / (numValues - 1));
+        return octaves;
+    }
+}
+
+//==============================================================================
+class FastMathTest : public juce::UnitTest
+{
+public:
+    FastMathTest() : juce::UnitTest("Fast math", "FastMath") {}
+
+    void runTest() override
+    {
+        constexpr int numValues = 1'000'003; // odd, so the grid does not line up with the mantissa
+
+        beginTest("log2 absolute error from 1e-6 to 1e6");
+        {
+            const auto gains = makeGains(numValues);
+            std::vector<float> block(gains.size());
+            fastmath::log2(block.data(), gains.data(), numValues);
+
+            auto error = 0., blockError = 0.;
+            for (size_t index = 0; index < gains.size(); ++index)
+            {
+                const auto reference = std::log2(static_cast<double>(gains[index]));
+                error = juce::jmax(error, std::abs(fastmath::log2(gains[index]) - reference));
+                blockError = juce::jmax(blockError, std::abs(block[index] - reference));
+            }
+            expect(error < 1.e-5, "log2 is off by " + juce::String(error));
+            expect(blockError < 1.e-5, "block log2 is off by " + juce::String(blockError));
+        }
+
+        beginTest("exp2 relative error from -100 to 100");
+        {
+            const auto octaves = makeOctaves(numValues);
+            std::vector<float> block(octaves.size());
+            fastmath::exp2(block.data(), octaves.data(), numValues);
+
+            auto error = 0., blockError = 0.;
+            for (size_t index = 0; index < octaves.size(); ++index)
+            {
+                const auto reference = std::exp2(static_cast<double>(octaves[index]));
+                error = juce::jmax(error, std::abs(fastmath::exp2(octaves[index]) - reference) / reference);
+                blockError = juce::jmax(blockError, std::abs(block[index] - reference) / reference);
+            }
+            expect(error < 1.e-6, "exp2 is off by " + juce::String(error));
+            expect(blockError < 1.e-6, "block exp2 is off by " + juce::String(blockError));
+        }
+
+        beginTest("exp2 clamps instead of overflowing");
+        {
+            expect(std::isfinite(fastmath::exp2(1'000.f)) && fastmath::exp2(1'000.f) > 0.f);
+            expect(fastmath::exp2(-1'000.f) >= 0.f && fastmath::exp2(-1'000.f) < 1.e-37f);
+        }
+
+        beginTest("decibels round trip");
+        {
+            auto error = 0.f;
+            for (auto decibels = -120.f; decibels <= 24.f; decibels += .01f)
+            {
+                error = juce::jmax(error, std::abs(fastmath::gainToDecibels(fastmath::decibelsToGain(decibels)) - decibels));
+                error = juce::jmax(error, std::abs(fastmath::gainToDecibels(juce::Decibels::decibelsToGain(decibels, -1'000.f)) - decibels));
+            }
+            expect(error < 1.e-4f, "decibels are off by " + juce::String(error));
+        }
+    }
+};
+
+static FastMathTest fastMathTest;
+
+//==============================================================================
+class FastMathBenchmark : public juce::UnitTest
+{
+public:
+    FastMathBenchmark() : juce::UnitTest("Fast math against libm", tests::benchmarkCategory) {}
+
+    void runTest() override
+    {
+        beginTest("ns per value over blocks of 512");
+
+        const auto gains = makeGains(numValues);
+        const auto octaves = makeOctaves(numValues);
+        std::vector<float> destination(static_cast<size_t>(numValues));
+
+        report("log2", gains, destination,
+               [](float* d, const float* s, int n) { fastmath::log2(d, s, n); },
+               [](float* d, const float* s, int n) { for (auto i = 0; i < n; ++i) d[i] = std::log2(s[i]); });
+
+        report("exp2", octaves, destination,
+               [](float* d, const float* s, int n) { fastmath::exp2(d, s, n); },
+               [](float* d, const float* s, int n) { for (auto i = 0; i < n; ++i) d[i] = std::exp2(s[i]); });
+
+        // the gain computer's ratio, x^(1 / ratio - 1)
+        report("pow", gains, destination,
+               [](float* d, const float* s, int n) { for (auto i = 0; i < n; ++i) d[i] = fastmath::pow(s[i], -.75f); },
+               [](float* d, const float* s, int n) { for (auto i = 0; i < n; ++i) d[i] = std::pow(s[i], -.75f); });
+    }
+
+private:
+    static constexpr int numValues = 1 << 20;
+    static constexpr int blockSize = 512;
+
+    template<typename Fast, typename Libm>
+    void report(const juce::String& name, const std::vector<float>& source, std::vector<float>& destination, Fast&& fast, Libm&& libm)
+    {
+        auto inBlocks = [&](auto& function)
+        {
+            return tests::measureSecs([&]
+            {
+                for (auto start = 0; start < numValues; start += blockSize)
+                    function(destination.data() + start, source.data() + start, blockSize);
+            });
+        };
+
+        const auto fastSecs = inBlocks(fast);
+        const auto libmSecs = inBlocks(libm);
+
+        logMessage(name.paddedRight(' ', 6)
+                   + "fastmath " + juce::String(fastSecs * 1.e9 / numValues, 2) + " ns, libm " + juce::String(libmSecs * 1.e9 / numValues, 2)
+                   + " ns, " + juce::String(libmSecs / fastSecs, 1) + "x");
+    }
+};
+
+static FastMathBenchmark fastMathBenchmark;
@@ -0,0 +1,179 @@
+/*
+  ==============================================================================
+
+    The loudness meter against the EBU Tech 3341 reference signals, and the
+    auto gain starting over when the host resets the processor.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "Tests.h"
+#include "../Source/Loudness.h"
+#include <vector>
+
+namespace
+{
+    constexpr double sampleRate = 48'000.;
+    constexpr int blockSize = 480; // 10 ms
+    constexpr float tolerance = .1f; // LU, what Tech 3341 allows
+
+    // a stretch of the stereo 1 kHz sine the reference signals are made of, the level is the sine's peak
+    struct Segment
+    {
+        float levelInDbfs;
+        double lengthInSecs;
+    };
+
+    // the segments back to back, the phase carries on across the level changes
+    std::vector<Segment> repeat(const std::vector<Segment>& period, double lengthInSecs)
+    {
+        std::vector<Segment> segments;
+        for (auto length = 0.; length < lengthInSecs;)
+            for (const auto& segment : period)
+            {
+                segments.push_back(segment);
+                length += segment.lengthInSecs;
+            }
+        return segments;
+    }
+
+    juce::AudioBuffer<float> makeTone(const std::vector<Segment>& segments)
+    {
+        auto numSamples = 0;
+        for (const auto& segment : segments)
+            numSamples += juce::roundToInt(segment.lengthInSecs * sampleRate);
+
+        juce::AudioBuffer<float> tone(2, numSamples);
+        const auto increment = juce::MathConstants<double>::twoPi * 1'000. / sampleRate;
+        auto sample = 0;
+        for (const auto& segment : segments)
+        {
+            const auto amplitude = juce::Decibels::decibelsToGain(static_cast<double>(segment.levelInDbfs));
+            for (const auto end = sample + juce::roundToInt(segment.lengthInSecs * sampleRate); sample < end; ++sample)
+            {
+                const auto value = static_cast<float>(amplitude * std::sin(increment * sample));
+                tone.setSample(0, sample, value);
+                tone.setSample(1, sample, value);
+            }
+        }
+        return tone;
+    }
+
+    // feeds the tone in 10 ms blocks and calls check after every block from settleSecs on
+    template<typename Check>
+    void measure(loudness::Meter& meter, const juce::AudioBuffer<float>& tone, double settleSecs, Check&& check)
+    {
+        meter.prepare(sampleRate);
+        for (auto start = 0; start < tone.getNumSamples(); start += blockSize)
+        {
+            const auto length = juce::jmin(blockSize, tone.getNumSamples() - start);
+            const float* channels[]{ tone.getReadPointer(0, start), tone.getReadPointer(1, start) };
+            meter.process(channels, 2, length);
+
+            if (start + length >= juce::roundToInt(settleSecs * sampleRate))
+                check();
+        }
+    }
+}
+
+//==============================================================================
+class LoudnessTest : public juce::UnitTest
+{
+public:
+    LoudnessTest() : juce::UnitTest("Loudness meter, EBU Tech 3341", "Loudness") {}
+
+    void runTest() override
+    {
+        // the multichannel cases 6 to 8 need more than two channels
+        loudness::Meter meter;
+
+        beginTest("case 1 and 2, steady sines");
+        for (const auto level : { -23.f, -33.f })
+        {
+            measure(meter, makeTone({ { level, 20. } }), 3., [&]
+            {
+                expectWithinAbsoluteError(meter.getMomentary(), level, tolerance, "momentary");
+                expectWithinAbsoluteError(meter.getShortTerm(), level, tolerance, "short-term");
+            });
+            expectWithinAbsoluteError(meter.getIntegrated(), level, tolerance, "integrated");
+        }
+
+        beginTest("case 3, the relative gate");
+        measure(meter, makeTone({ { -36.f, 10. }, { -23.f, 60. }, { -36.f, 10. } }), 0., [] {});
+        expectWithinAbsoluteError(meter.getIntegrated(), -23.f, tolerance);
+
+        beginTest("case 4, the absolute gate");
+        measure(meter, makeTone({ { -72.f, 10. }, { -36.f, 10. }, { -23.f, 60. }, { -36.f, 10. }, { -72.f, 10. } }), 0., [] {});
+        expectWithinAbsoluteError(meter.getIntegrated(), -23.f, tolerance);
+
+        beginTest("case 5, blocks just above the relative gate");
+        measure(meter, makeTone({ { -26.f, 20. }, { -20.f, 20.1 }, { -26.f, 20. } }), 0., [] {});
+        expectWithinAbsoluteError(meter.getIntegrated(), -23.f, tolerance);
+
+        beginTest("case 9, short-term of a 3 s period");
+        measure(meter, makeTone(repeat({ { -20.f, 1.34 }, { -30.f, 1.66 } }, 20.)), 3., [&]
+        {
+            expectWithinAbsoluteError(meter.getShortTerm(), -23.f, tolerance);
+        });
+
+        beginTest("case 12, momentary of a 400 ms period");
+        measure(meter, makeTone(repeat({ { -20.f, .18 }, { -30.f, .22 } }, 20.)), 1., [&]
+        {
+            expectWithinAbsoluteError(meter.getMomentary(), -23.f, tolerance);
+        });
+    }
+};
+
+static LoudnessTest loudnessTest;
+
+//==============================================================================
+class AutoGainTest : public juce::UnitTest
+{
+public:
+    AutoGainTest() : juce::UnitTest("Auto gain", "Loudness") {}
+
+    void runTest() override
+    {
+        const tests::Setup setup{ "auto gain", { { "AUTOGAIN", 1.f }, { "TARGETLUFS", -14.f }, { "RATIO", 4.f } }, true };
+
+        // the auto gain and the meter have to start over, or the second render starts at the first one's gain
+        beginTest("a reset processor renders like a fresh one");
+        {
+            UltiknobAudioProcessor processor;
+            tests::prepare(processor, setup, sampleRate, 512);
+            auto first = tests::makeSignal(sampleRate, 4.);
+            tests::process(processor, first, 512);
+
+            processor.reset();
+            processor.setRandomSeed(tests::randomSeed);
+            auto second = tests::makeSignal(sampleRate, 4.);
+            tests::process(processor, second, 512);
+
+            const auto difference = tests::maxAbsoluteDifference(second, tests::render(setup, sampleRate, 512, 4.));
+            expect(difference == 0.f, "the reset processor is off by " + juce::String(difference));
+        }
+
+        beginTest("the telemetry reports the loudness");
+        {
+            UltiknobAudioProcessor processor;
+            tests::prepare(processor, { "metered", {}, true }, sampleRate, 512);
+            auto& telemetry = processor.getTelemetry();
+            telemetry.connect();
+
+            auto buffer = tests::makeSignal(sampleRate, 1.);
+            tests::process(processor, buffer, 512);
+
+            telemetry::Frame frame, last;
+            while (telemetry.read(frame))
+                last = frame;
+            telemetry.disconnect();
+
+            expect(last.momentaryLoudness > loudness::silence, "no momentary loudness");
+            expect(last.shortTermLoudness > loudness::silence, "no short-term loudness");
+            expect(last.integratedLoudness > loudness::silence, "no integrated loudness");
+        }
+    }
+};
+
+static AutoGainTest autoGainTest;
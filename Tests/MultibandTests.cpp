@@ -0,0 +1,96 @@
+/*
+  ==============================================================================
+
+    The multiband core: the three bands sum back to an allpass, and a loud
+    band is compressed without ducking the others.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "Tests.h"
+#include "../Source/Multiband.h"
+#include <vector>
+
+namespace
+{
+    constexpr int fftOrder = 13;
+    constexpr int fftSize = 1 << fftOrder;
+
+    // magnitudes of the first fftSize samples, bins 0 to fftSize / 2
+    std::vector<float> magnitudes(const float* samples)
+    {
+        juce::dsp::FFT fft(fftOrder);
+        std::vector<float> data(2 * fftSize, 0.f);
+        std::copy(samples, samples + fftSize, data.begin());
+        fft.performFrequencyOnlyForwardTransform(data.data());
+        data.resize(fftSize / 2 + 1);
+        return data;
+    }
+}
+
+//==============================================================================
+class MultibandTest : public juce::UnitTest
+{
+public:
+    MultibandTest() : juce::UnitTest("Multiband compressor", "Multiband") {}
+
+    void runTest() override
+    {
+        for (const auto sampleRate : { 44'100., 48'000., 96'000. })
+        {
+            beginTest("the bands sum to an allpass at " + juce::String(juce::roundToInt(sampleRate)) + " Hz");
+
+            // ratio 1 leaves every band at unity gain, so only the crossover is left
+            dsp::MultibandCompressor compressor;
+            compressor.prepare(sampleRate, fftSize);
+            compressor.updateParameters(1.f, 0.f, 5.f, 20.f);
+
+            std::vector<float> impulse(fftSize, 0.f);
+            impulse.front() = 1.f;
+            float* channels[]{ impulse.data() };
+            compressor.processBlock(channels, 1, fftSize);
+
+            auto deviation = 0.f;
+            for (const auto magnitude : magnitudes(impulse.data()))
+                deviation = juce::jmax(deviation, std::abs(juce::Decibels::gainToDecibels(magnitude, -200.f)));
+            expect(deviation < .01f, "the magnitude response is off by " + juce::String(deviation) + " dB");
+        }
+
+        beginTest("a loud band does not duck the others");
+        {
+            constexpr double sampleRate = 48'000.;
+            constexpr int lowBin = 17;      // about 100 Hz, low band
+            constexpr int highBin = 1'365;  // about 8 kHz, high band
+            const auto numSamples = 12 * fftSize;
+
+            std::vector<float> left(static_cast<size_t>(numSamples)), right;
+            for (auto sample = 0; sample < numSamples; ++sample)
+            {
+                const auto phase = juce::MathConstants<double>::twoPi * sample / fftSize;
+                left[static_cast<size_t>(sample)] = static_cast<float>(.9 * std::sin(lowBin * phase) + .01 * std::sin(highBin * phase));
+            }
+            right = left;
+            const auto input = magnitudes(left.data());
+
+            dsp::MultibandCompressor compressor;
+            compressor.prepare(sampleRate, fftSize);
+            compressor.updateParameters(8.f, -30.f, 5.f, 20.f);
+            for (auto start = 0; start < numSamples; start += fftSize)
+            {
+                float* channels[]{ left.data() + start, right.data() + start };
+                compressor.processBlock(channels, 2, fftSize);
+            }
+
+            // the last frame, long after the detectors settled
+            const auto output = magnitudes(left.data() + numSamples - fftSize);
+            const auto lowChange = juce::Decibels::gainToDecibels(output[lowBin] / input[lowBin]);
+            const auto highChange = juce::Decibels::gainToDecibels(output[highBin] / input[highBin]);
+
+            expect(lowChange < -12.f, "the low band only moved by " + juce::String(lowChange) + " dB");
+            expect(std::abs(highChange) < .1f, "the high band moved by " + juce::String(highChange) + " dB");
+        }
+    }
+};
+
+static MultibandTest multibandTest;
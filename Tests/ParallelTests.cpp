@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    The offline channel workers: parallel renders against serial ones,
+    starting and running the helpers back to back, and a benchmark of the
+    wall time they save.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "Tests.h"
+#include "../Source/Parallel.h"
+#include <atomic>
+
+namespace
+{
+    // the workers only take blocks from minimumParallelBlockSize on, the rest of the block sizes run serially anyway
+    constexpr int blockSizes[]{ dsp::Chain::minimumParallelBlockSize, 4'096, 10'000 };
+
+    // an offline render, with the channel workers switched on or off
+    tests::Setup makeSetup(bool isMultiband, bool isParallel)
+    {
+        return { isParallel ? "parallel" : "serial", {
+            { "QUALITY", 2.f },
+            { "LOWCUT", 40.f },
+            { "HIGHCUT", 12'000.f },
+            { "DELAYTIME", 25.f },
+            { "RATIO", 8.f },
+            { "THRESHOLD", -18.f },
+            { "DRIVE", 12.f },
+            { "TAPS", 3.f },
+            { "DIRTYMODE", 1.f },
+            { "MULTIBAND", isMultiband ? 1.f : 0.f }, // the multiband core links the channels, so the threads meet at the barrier
+            { "OFFLINEPARALLEL", isParallel ? 1.f : 0.f }
+        }, true };
+    }
+}
+
+//==============================================================================
+class ParallelTest : public juce::UnitTest
+{
+public:
+    ParallelTest() : juce::UnitTest("Channel workers", "Parallel") {}
+
+    void runTest() override
+    {
+        for (const auto isMultiband : { false, true })
+        {
+            beginTest(isMultiband ? "parallel matches serial, multiband" : "parallel matches serial, single band");
+
+            for (const auto blockSize : blockSizes)
+            {
+                const auto difference = tests::maxAbsoluteDifference(tests::render(makeSetup(isMultiband, true), 48'000., blockSize, 2.5),
+                                                                     tests::render(makeSetup(isMultiband, false), 48'000., blockSize, 2.5));
+                expect(difference <= 1.e-5f, "block size " + juce::String(blockSize) + " is off by " + juce::String(difference));
+            }
+        }
+
+        // a helper that only looked at the generation once it was scheduled could miss the first run and hang it
+        beginTest("running right after starting reaches every helper");
+        {
+            parallel::ChannelWorkers workers;
+            std::atomic<int> numCalls{ 0 };
+            auto task = [&numCalls](int) { numCalls.fetch_add(1); };
+
+            constexpr int numStarts = 2'000;
+            for (auto start = 0; start < numStarts; ++start)
+            {
+                workers.start(1);
+                workers.run(task);
+                workers.run(task);
+            }
+            workers.stop();
+
+            expectEquals(numCalls.load(), numStarts * 2 * 2);
+        }
+    }
+};
+
+static ParallelTest parallelTest;
+
+//==============================================================================
+class ParallelBenchmark : public juce::UnitTest
+{
+public:
+    ParallelBenchmark() : juce::UnitTest("Channel workers against serial", tests::benchmarkCategory) {}
+
+    void runTest() override
+    {
+        beginTest("10 s of stereo at 48 kHz in blocks of 4096, high quality");
+
+        for (const auto isMultiband : { false, true })
+        {
+            const auto serialSecs = tests::measureSecs([&] { tests::render(makeSetup(isMultiband, false), 48'000., 4'096, 10.); });
+            const auto parallelSecs = tests::measureSecs([&] { tests::render(makeSetup(isMultiband, true), 48'000., 4'096, 10.); });
+
+            logMessage(juce::String(isMultiband ? "multiband    " : "single band  ")
+                       + "serial " + juce::String(serialSecs * 1.e3, 1) + " ms, parallel " + juce::String(parallelSecs * 1.e3, 1)
+                       + " ms, " + juce::String(serialSecs / parallelSecs, 2) + "x");
+        }
+    }
+};
+
+static ParallelBenchmark parallelBenchmark;
@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+    Renders fixed signals through UltiknobAudioProcessor and checks that the
+    result neither depends on the host's block size nor drifts from the
+    golden renders in Tests/Golden, and that hosts calling the processor
+    in an unusual order get the same result.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "Tests.h"
+#include <memory>
+#include <vector>
+
+namespace
+{
+    // longer than one delay modulation period, so every render picks at least one new random delay time
+    constexpr double lengthInSecs = 2.5;
+
+    constexpr int referenceBlockSize = 512;
+    constexpr int blockSizes[]{ 1, 7, 64, 511, 4'096, 10'000 };
+    constexpr double sampleRates[]{ 44'100., 48'000., 96'000. };
+
+    // block sizes only reorder the same per sample arithmetic, goldens may come from another compiler or libm
+    constexpr float blockSizeTolerance = 1.e-5f;
+    constexpr float goldenTolerance = 1.e-4f;
+
+    std::vector<tests::Setup> makeSetups()
+    {
+        // a realtime render, so the requested tier goes through the watchdog
+        tests::Setup clean{ "clean", {
+            { "QUALITY", 1.f },
+            { "LOWCUT", 40.f },
+            { "HIGHCUT", 12'000.f },
+            { "DELAYTIME", 10.f },
+            { "RATIO", 4.f },
+            { "THRESHOLD", -18.f },
+            { "INPUTGAIN", 3.f }
+        }, false };
+
+        // an offline render with everything optional switched on: the top tier, drive, ensemble taps,
+        // the multiband core and the channel workers for the blocks that are large enough
+        tests::Setup dirty{ "dirty", {
+            { "QUALITY", 2.f },
+            { "LOWCUT", 40.f },
+            { "HIGHCUT", 12'000.f },
+            { "DELAYTIME", 25.f },
+            { "RATIO", 8.f },
+            { "THRESHOLD", -18.f },
+            { "INPUTGAIN", 3.f },
+            { "DRIVE", 12.f },
+            { "TAPS", 3.f },
+            { "DIRTYMODE", 1.f },
+            { "MULTIBAND", 1.f }
+        }, true };
+
+        return { clean, dirty };
+    }
+
+    bool readGolden(const juce::File& file, juce::AudioBuffer<float>& golden)
+    {
+        if (!file.existsAsFile())
+            return false;
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatReader> reader(wav.createReaderFor(file.createInputStream().release(), true));
+        if (reader == nullptr)
+            return false;
+
+        golden.setSize(static_cast<int>(reader->numChannels), static_cast<int>(reader->lengthInSamples));
+        return reader->read(&golden, 0, golden.getNumSamples(), 0, true, true);
+    }
+
+    // 32 bit float wav, so the golden holds exactly what was rendered
+    bool writeGolden(const juce::File& file, const juce::AudioBuffer<float>& rendered, double sampleRate)
+    {
+        file.deleteFile();
+        std::unique_ptr<juce::FileOutputStream> stream(file.createOutputStream());
+        if (stream == nullptr)
+            return false;
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(rendered.getNumChannels()), 32, {}, 0));
+        if (writer == nullptr)
+            return false;
+        stream.release(); // the writer owns the stream now
+
+        return writer->writeFromAudioSampleBuffer(rendered, 0, rendered.getNumSamples());
+    }
+}
+
+//==============================================================================
+class ProcessorInvarianceTest : public juce::UnitTest
+{
+public:
+    ProcessorInvarianceTest() : juce::UnitTest("Processor block size and sample rate invariance", "Processor") {}
+
+    void runTest() override
+    {
+        const auto& options = tests::getOptions();
+
+        for (const auto& setup : makeSetups())
+        {
+            for (const auto sampleRate : sampleRates)
+            {
+                const auto name = setup.name + " at " + juce::String(juce::roundToInt(sampleRate)) + " Hz";
+                beginTest(name);
+
+                const auto reference = tests::render(setup, sampleRate, referenceBlockSize, lengthInSecs);
+                checkGolden(options, options.goldenFolder.getChildFile(setup.name + "_" + juce::String(juce::roundToInt(sampleRate)) + ".wav"), reference, sampleRate);
+
+                for (const auto blockSize : blockSizes)
+                {
+                    const auto difference = tests::maxAbsoluteDifference(tests::render(setup, sampleRate, blockSize, lengthInSecs), reference);
+                    expect(difference <= blockSizeTolerance,
+                           name + ", block size " + juce::String(blockSize) + " is off by " + juce::String(difference));
+                }
+            }
+        }
+    }
+
+private:
+    void checkGolden(const tests::Options& options, const juce::File& file, const juce::AudioBuffer<float>& reference, double sampleRate)
+    {
+        if (options.shouldUpdateGolden)
+        {
+            expect(writeGolden(file, reference, sampleRate), "cannot write " + file.getFullPathName());
+            return;
+        }
+
+        juce::AudioBuffer<float> golden;
+        if (!readGolden(file, golden))
+        {
+            expect(false, "no golden render " + file.getFullPathName() + ", record it with --update-golden");
+            return;
+        }
+
+        const auto difference = tests::maxAbsoluteDifference(reference, golden);
+        expect(difference <= goldenTolerance, file.getFileName() + " is off by " + juce::String(difference));
+    }
+};
+
+static ProcessorInvarianceTest processorInvarianceTest;
+
+//==============================================================================
+class ProcessorLifecycleTest : public juce::UnitTest
+{
+public:
+    ProcessorLifecycleTest() : juce::UnitTest("Processor lifecycle", "Processor") {}
+
+    void runTest() override
+    {
+        const tests::Setup setup{ "dirty offline", { { "DIRTYMODE", 1.f }, { "MULTIBAND", 1.f }, { "RATIO", 8.f } }, true };
+
+        // AU Reset and VST3 setProcessing may arrive on an instance that was never prepared
+        beginTest("reset before prepareToPlay");
+        {
+            UltiknobAudioProcessor processor;
+            processor.reset();
+            processor.releaseResources();
+
+            tests::prepare(processor, setup, 48'000., referenceBlockSize);
+            auto buffer = tests::makeSignal(48'000., .5);
+            tests::process(processor, buffer, referenceBlockSize);
+
+            expect(tests::maxAbsoluteDifference(buffer, tests::render(setup, 48'000., referenceBlockSize, .5)) == 0.f);
+        }
+    }
+};
+
+static ProcessorLifecycleTest processorLifecycleTest;
@@ -0,0 +1,263 @@
+/*
+  ==============================================================================
+
+    The dirty mode drive: float ADAA against a double precision reference,
+    the crossfade between the waveshapers, and a benchmark of aliasing and
+    speed against oversampled tanh.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "Tests.h"
+#include "../Source/Saturator.h"
+#include <functional>
+#include <vector>
+
+namespace
+{
+    constexpr double sampleRate = 48'000.;
+    constexpr int blockSize = 512;
+
+    // an exponential sweep from 20 Hz to 20 kHz, the drive sees every slope from tiny to steep
+    std::vector<float> makeSweep(int numSamples, float amplitude)
+    {
+        std::vector<float> sweep(static_cast<size_t>(numSamples));
+        const auto lengthInSecs = numSamples / sampleRate;
+        const auto rate = std::log(1'000.);
+        for (auto sample = 0; sample < numSamples; ++sample)
+        {
+            const auto time = sample / sampleRate;
+            const auto phase = juce::MathConstants<double>::twoPi * 20. * lengthInSecs / rate * (std::exp(rate * time / lengthInSecs) - 1.);
+            sweep[static_cast<size_t>(sample)] = amplitude * static_cast<float>(std::sin(phase));
+        }
+        return sweep;
+    }
+
+    void process(dsp::Saturator& saturator, std::vector<float>& samples, int numSamples)
+    {
+        for (auto start = 0; start < numSamples; start += blockSize)
+        {
+            auto block = samples.data() + start;
+            saturator.processBlock(&block, 1, juce::jmin(blockSize, numSamples - start));
+        }
+    }
+
+    // first order ADAA of tanh in double, as written in the textbooks
+    std::vector<float> referenceAntialiased(const std::vector<float>& input, float drive)
+    {
+        auto logCosh = [](double x) { return std::abs(x) + std::log1p(std::exp(-2. * std::abs(x))) - std::log(2.); };
+
+        std::vector<float> output(input.size());
+        auto previousInput = static_cast<double>(input.front() * drive);
+        auto previousAntiderivative = logCosh(previousInput);
+        for (size_t sample = 0; sample < input.size(); ++sample)
+        {
+            const auto x = static_cast<double>(input[sample] * drive);
+            const auto antiderivative = logCosh(x);
+            const auto difference = x - previousInput;
+            const auto y = std::abs(difference) > 1.e-5
+                ? (antiderivative - previousAntiderivative) / difference
+                : std::tanh(.5 * (x + previousInput));
+
+            output[sample] = static_cast<float>(y / drive);
+            previousInput = x;
+            previousAntiderivative = antiderivative;
+        }
+        return output;
+    }
+}
+
+//==============================================================================
+class SaturatorTest : public juce::UnitTest
+{
+public:
+    SaturatorTest() : juce::UnitTest("Saturator", "Saturator") {}
+
+    void runTest() override
+    {
+        const auto numSamples = static_cast<int>(sampleRate);
+
+        beginTest("float ADAA matches the double precision reference");
+        for (const auto driveInDb : { 0.f, 6.f, 12.f, 24.f })
+        {
+            for (const auto amplitude : { .01f, .5f, 1.f })
+            {
+                dsp::Saturator saturator;
+                saturator.prepare(sampleRate, blockSize);
+                saturator.updateParameters(driveInDb);
+
+                auto samples = makeSweep(numSamples, amplitude);
+                const auto reference = referenceAntialiased(samples, juce::Decibels::decibelsToGain(driveInDb));
+                process(saturator, samples, numSamples);
+
+                auto difference = 0.f;
+                for (auto sample = 0; sample < numSamples; ++sample)
+                    difference = juce::jmax(difference, std::abs(samples[static_cast<size_t>(sample)] - reference[static_cast<size_t>(sample)]));
+
+                expect(difference < 5.e-5f, "drive " + juce::String(driveInDb) + " dB, amplitude " + juce::String(amplitude) + " is off by " + juce::String(difference));
+            }
+        }
+
+        beginTest("switching the waveshaper crossfades between both");
+        {
+            const auto switchAt = 40 * blockSize;
+            const auto fadeLength = static_cast<int>(sampleRate * .02);
+
+            auto render = [&](bool startAntialiased, bool switches)
+            {
+                dsp::Saturator saturator;
+                saturator.prepare(sampleRate, blockSize);
+                saturator.updateParameters(18.f);
+                saturator.setAntialiasing(startAntialiased);
+                saturator.reset();
+
+                auto samples = makeSweep(numSamples, .8f);
+                for (auto start = 0; start < numSamples; start += blockSize)
+                {
+                    if (switches && start == switchAt)
+                        saturator.setAntialiasing(!startAntialiased);
+
+                    auto block = samples.data() + start;
+                    saturator.processBlock(&block, 1, juce::jmin(blockSize, numSamples - start));
+                }
+                return samples;
+            };
+
+            const auto antialiased = render(true, false);
+            const auto plain = render(false, false);
+            const auto switched = render(true, true);
+
+            auto isBetween = [](float value, float a, float b) { return value >= juce::jmin(a, b) - 1.e-6f && value <= juce::jmax(a, b) + 1.e-6f; };
+
+            auto numOutside = 0;
+            for (auto sample = 0; sample < numSamples; ++sample)
+            {
+                const auto index = static_cast<size_t>(sample);
+                if (sample < switchAt)
+                    numOutside += switched[index] == antialiased[index] ? 0 : 1;
+                else if (sample < switchAt + fadeLength)
+                    numOutside += isBetween(switched[index], antialiased[index], plain[index]) ? 0 : 1;
+                else
+                    numOutside += std::abs(switched[index] - plain[index]) < 1.e-6f ? 0 : 1;
+            }
+            expectEquals(numOutside, 0, "samples not on the crossfade");
+        }
+    }
+};
+
+static SaturatorTest saturatorTest;
+
+//==============================================================================
+class SaturatorBenchmark : public juce::UnitTest
+{
+public:
+    SaturatorBenchmark() : juce::UnitTest("Saturator against oversampled tanh", tests::benchmarkCategory) {}
+
+    void runTest() override
+    {
+        beginTest("aliasing and speed at 18 dB drive");
+
+        logMessage("method          alias (dB)   ns/sample");
+        report("tanh", [](std::vector<float>& samples, int numSamples)
+        {
+            return plainAndAntialiased(samples, numSamples, false);
+        });
+        report("tanh ADAA", [](std::vector<float>& samples, int numSamples)
+        {
+            return plainAndAntialiased(samples, numSamples, true);
+        });
+        for (const auto order : { 1, 2, 3 })
+        {
+            report("tanh " + juce::String(1 << order) + "x", [order](std::vector<float>& samples, int numSamples)
+            {
+                return oversampled(samples, numSamples, order);
+            });
+        }
+    }
+
+private:
+    static constexpr float driveInDb = 18.f;
+
+    // the test tone sits on an fft bin, so the harmonics do as well and every other bin holds aliases only
+    static constexpr int fftOrder = 12;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int toneBin = 317;
+
+    using Method = std::function<double(std::vector<float>&, int)>;
+
+    static double plainAndAntialiased(std::vector<float>& samples, int numSamples, bool isAntialiased)
+    {
+        dsp::Saturator saturator;
+        saturator.prepare(sampleRate, blockSize);
+        saturator.updateParameters(driveInDb);
+        saturator.setAntialiasing(isAntialiased);
+        saturator.reset();
+
+        return tests::measureSecs([&] { process(saturator, samples, numSamples); }, 1);
+    }
+
+    static double oversampled(std::vector<float>& samples, int numSamples, int order)
+    {
+        juce::dsp::Oversampling<float> oversampling(1, static_cast<size_t>(order), juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, true);
+        oversampling.initProcessing(blockSize);
+
+        const auto drive = juce::Decibels::decibelsToGain(driveInDb);
+        return tests::measureSecs([&]
+        {
+            for (auto start = 0; start < numSamples; start += blockSize)
+            {
+                float* channels[]{ samples.data() + start };
+                juce::dsp::AudioBlock<float> block(channels, 1, static_cast<size_t>(juce::jmin(blockSize, numSamples - start)));
+
+                auto upsampled = oversampling.processSamplesUp(block);
+                auto data = upsampled.getChannelPointer(0);
+                for (size_t sample = 0; sample < upsampled.getNumSamples(); ++sample)
+                    data[sample] = std::tanh(data[sample] * drive) / drive;
+                oversampling.processSamplesDown(block);
+            }
+        }, 1);
+    }
+
+    void report(const juce::String& name, const Method& method)
+    {
+        // one second to time, the last fft frame of it to look at once the filters have settled
+        const auto numSamples = static_cast<int>(sampleRate);
+
+        auto bestSecs = std::numeric_limits<double>::max();
+        std::vector<float> samples;
+        for (auto run = 0; run < 5; ++run)
+        {
+            samples.assign(static_cast<size_t>(numSamples), 0.f);
+            for (auto sample = 0; sample < numSamples; ++sample)
+                samples[static_cast<size_t>(sample)] = .8f * static_cast<float>(std::sin(juce::MathConstants<double>::twoPi * toneBin * sample / fftSize));
+
+            bestSecs = juce::jmin(bestSecs, method(samples, numSamples));
+        }
+
+        logMessage(name.paddedRight(' ', 16)
+                   + juce::String(aliasingInDb(samples.data() + numSamples - fftSize), 1).paddedLeft(' ', 10)
+                   + juce::String(bestSecs * 1.e9 / numSamples, 2).paddedLeft(' ', 12));
+    }
+
+    // energy in the bins that are neither dc nor a harmonic, relative to all of it
+    static double aliasingInDb(const float* frame)
+    {
+        juce::dsp::FFT fft(fftOrder);
+        std::vector<float> data(2 * fftSize, 0.f);
+        std::copy(frame, frame + fftSize, data.begin());
+        fft.performFrequencyOnlyForwardTransform(data.data());
+
+        auto total = 0., aliases = 0.;
+        for (auto bin = 1; bin <= fftSize / 2; ++bin)
+        {
+            const auto power = static_cast<double>(data[static_cast<size_t>(bin)]) * data[static_cast<size_t>(bin)];
+            total += power;
+            if (bin % toneBin != 0)
+                aliases += power;
+        }
+        return 10. * std::log10(juce::jmax(aliases, 1.e-30) / total);
+    }
+};
+
+static SaturatorBenchmark saturatorBenchmark;
@@ -0,0 +1,139 @@
+/*
+  ==============================================================================
+
+    The binary state: round trips, blobs written by older versions, and the
+    blobs that must be refused.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "Tests.h"
+#include "../Source/State.h"
+
+namespace
+{
+    // the caller's defaults, so it shows which values a read touched
+    constexpr float untouched = -1.f;
+
+    state::Values makeValues()
+    {
+        state::Values values;
+        for (auto i = 0; i < state::numParameters; ++i)
+            values[static_cast<size_t>(i)] = 1.5f * static_cast<float>(i) + .25f;
+        return values;
+    }
+
+    state::Values makeUntouched()
+    {
+        state::Values values;
+        values.fill(untouched);
+        return values;
+    }
+
+    // a blob laid out like state::write, but with any version and number of values
+    juce::MemoryBlock makeBlob(std::uint16_t version, int numValues)
+    {
+        juce::MemoryBlock blob;
+        {
+            juce::MemoryOutputStream stream(blob, false);
+            stream.writeInt(static_cast<int>(state::magic));
+            stream.writeShort(static_cast<short>(version));
+            stream.writeShort(static_cast<short>(numValues));
+            for (auto i = 0; i < numValues; ++i)
+                stream.writeFloat(1.5f * static_cast<float>(i) + .25f);
+        }
+        const auto checksum = state::checksum(blob.getData(), blob.getSize());
+        juce::MemoryOutputStream(blob, true).writeInt(static_cast<int>(checksum));
+        return blob;
+    }
+
+    bool read(const juce::MemoryBlock& blob, state::Values& values)
+    {
+        return state::read(blob.getData(), static_cast<int>(blob.getSize()), values);
+    }
+}
+
+//==============================================================================
+class StateTest : public juce::UnitTest
+{
+public:
+    StateTest() : juce::UnitTest("Binary state", "State") {}
+
+    void runTest() override
+    {
+        beginTest("round trip");
+        {
+            juce::MemoryBlock blob;
+            state::write(makeValues(), blob);
+
+            expect(state::isBinary(blob.getData(), static_cast<int>(blob.getSize())));
+            expect(blob == makeBlob(state::currentVersion, state::numParameters), "write does not match the documented layout");
+
+            auto values = makeUntouched();
+            expect(read(blob, values));
+            expect(values == makeValues());
+        }
+
+        beginTest("older versions keep the defaults of the parameters they did not have");
+        for (std::uint16_t version = 1; version < state::currentVersion; ++version)
+        {
+            const auto numValues = state::numValuesInVersion[version];
+
+            auto values = makeUntouched();
+            expect(read(makeBlob(version, numValues), values), "version " + juce::String(version) + " is refused");
+
+            for (auto i = 0; i < state::numParameters; ++i)
+            {
+                const auto expected = i < numValues ? makeValues()[static_cast<size_t>(i)] : untouched;
+                expectEquals(values[static_cast<size_t>(i)], expected, juce::String("version ") + juce::String(version) + ", " + state::parameterIds[static_cast<size_t>(i)]);
+            }
+        }
+
+        beginTest("unknown versions and damaged blobs are refused untouched");
+        {
+            auto expectRefused = [this](const juce::MemoryBlock& blob, const juce::String& what)
+            {
+                auto values = makeUntouched();
+                expect(!read(blob, values), what + " is read");
+                expect(values == makeUntouched(), what + " changed the values");
+            };
+
+            expectRefused(makeBlob(0, 0), "version 0");
+            expectRefused(makeBlob(state::currentVersion + 1, state::numParameters + 1), "a newer version");
+            expectRefused(makeBlob(state::currentVersion + 1, state::numParameters), "a newer version of the same size");
+            expectRefused(makeBlob(state::currentVersion, state::numParameters - 1), "a value count that does not match the version");
+
+            auto corrupted = makeBlob(state::currentVersion, state::numParameters);
+            static_cast<char*>(corrupted.getData())[sizeof(state::Header) + 3] ^= 0x10;
+            expectRefused(corrupted, "a corrupted blob");
+
+            auto truncated = makeBlob(state::currentVersion, state::numParameters);
+            truncated.setSize(truncated.getSize() - 1);
+            expectRefused(truncated, "a truncated blob");
+        }
+
+        beginTest("ValueTree blobs from before the binary format");
+        {
+            juce::ValueTree tree("Parameters");
+            for (auto i = 0; i < 15; ++i)
+            {
+                juce::ValueTree parameter("PARAM");
+                parameter.setProperty("id", state::parameterIds[static_cast<size_t>(i)], nullptr);
+                parameter.setProperty("value", makeValues()[static_cast<size_t>(i)], nullptr);
+                tree.appendChild(parameter, nullptr);
+            }
+
+            juce::MemoryOutputStream stream;
+            tree.writeToStream(stream);
+
+            auto values = makeUntouched();
+            expect(!state::isBinary(stream.getData(), static_cast<int>(stream.getDataSize())));
+            expect(state::readValueTree(stream.getData(), static_cast<int>(stream.getDataSize()), tree.getType(), values));
+            for (auto i = 0; i < state::numParameters; ++i)
+                expectEquals(values[static_cast<size_t>(i)], i < 15 ? makeValues()[static_cast<size_t>(i)] : untouched);
+        }
+    }
+};
+
+static StateTest stateTest;
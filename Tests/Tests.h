@@ -0,0 +1,143 @@
+/*
+  ==============================================================================
+
+    Shared pieces of the UltiknobTests console app.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "../Source/PluginProcessor.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace tests
+{
+    // tests in this category only run with --bench
+    static constexpr const char* benchmarkCategory = "Benchmarks";
+
+    struct Options
+    {
+        juce::File goldenFolder;
+        bool shouldUpdateGolden{ false };
+    };
+
+    // set up by main before any test runs
+    Options& getOptions();
+
+    // fastest of numRuns calls, in seconds, so a busy machine does not inflate the result
+    template<typename Function>
+    double measureSecs(Function&& function, int numRuns = 5)
+    {
+        auto best = std::numeric_limits<double>::max();
+        for (auto run = 0; run < numRuns; ++run)
+        {
+            const auto startTicks = juce::Time::getHighResolutionTicks();
+            function();
+            best = std::min(best, juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks));
+        }
+        return best;
+    }
+
+    // seeds the delay modulation and the noise in makeSignal, so every render is reproducible
+    static constexpr juce::int64 randomSeed = 0x756c7469; // "ulti"
+
+    // stereo, with bursts for the compressor and broadband noise for the filters
+    inline juce::AudioBuffer<float> makeSignal(double sampleRate, double lengthInSecs)
+    {
+        const auto numSamples = static_cast<int>(sampleRate * lengthInSecs);
+        juce::AudioBuffer<float> signal(2, numSamples);
+        juce::Random random(randomSeed);
+
+        const auto twoPi = juce::MathConstants<double>::twoPi;
+        for (auto sample = 0; sample < numSamples; ++sample)
+        {
+            const auto time = static_cast<double>(sample) / sampleRate;
+            const auto burst = std::fmod(time, .5) < .25 ? 1. : .1;
+
+            const auto left = burst * (.5 * std::sin(twoPi * 220. * time) + .25 * std::sin(twoPi * 3'300. * time));
+            const auto right = .4 * std::sin(twoPi * 97. * time) * (1. - time / lengthInSecs) + .3 * (random.nextFloat() * 2. - 1.);
+
+            signal.setSample(0, sample, static_cast<float>(left));
+            signal.setSample(1, sample, static_cast<float>(right));
+        }
+        return signal;
+    }
+
+    // how a render drives the processor, parameters are plain values by id and the others keep their defaults
+    struct Setup
+    {
+        juce::String name;
+        std::vector<std::pair<const char*, float>> parameters;
+        bool isNonRealtime{ false };
+    };
+
+    inline void applyParameters(UltiknobAudioProcessor& processor, const Setup& setup)
+    {
+        for (const auto& idAndValue : setup.parameters)
+        {
+            auto* parameter = processor.params.getParameter(idAndValue.first);
+            jassert(parameter != nullptr);
+            if (parameter != nullptr)
+                parameter->setValueNotifyingHost(parameter->convertTo0to1(idAndValue.second));
+        }
+    }
+
+    // the way a host starts a render: prepare, reset, then blocks of blockSize, the last one shorter
+    inline void prepare(UltiknobAudioProcessor& processor, const Setup& setup, double sampleRate, int blockSize)
+    {
+        processor.setNonRealtime(setup.isNonRealtime);
+        applyParameters(processor, setup);
+        processor.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+        processor.reset();
+        processor.setRandomSeed(randomSeed);
+    }
+
+    inline void process(UltiknobAudioProcessor& processor, juce::AudioBuffer<float>& buffer, int blockSize)
+    {
+        juce::MidiBuffer midiMessages;
+        for (auto start = 0; start < buffer.getNumSamples(); start += blockSize)
+        {
+            const auto length = juce::jmin(blockSize, buffer.getNumSamples() - start);
+            juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), buffer.getNumChannels(), start, length);
+            processor.processBlock(block, midiMessages);
+        }
+    }
+
+    // makeSignal through a fresh processor
+    inline juce::AudioBuffer<float> render(const Setup& setup, double sampleRate, int blockSize, double lengthInSecs)
+    {
+        auto processor = std::make_unique<UltiknobAudioProcessor>();
+        prepare(*processor, setup, sampleRate, blockSize);
+
+        auto buffer = makeSignal(sampleRate, lengthInSecs);
+        process(*processor, buffer, blockSize);
+
+        processor->releaseResources();
+        return buffer;
+    }
+
+    inline float maxAbsoluteDifference(const juce::AudioBuffer<float>& a, const juce::AudioBuffer<float>& b)
+    {
+        if (a.getNumChannels() != b.getNumChannels() || a.getNumSamples() != b.getNumSamples())
+            return std::numeric_limits<float>::infinity();
+
+        auto difference = 0.f;
+        for (auto channel = 0; channel < a.getNumChannels(); ++channel)
+            for (auto sample = 0; sample < a.getNumSamples(); ++sample)
+            {
+                const auto sampleDifference = std::abs(a.getSample(channel, sample) - b.getSample(channel, sample));
+                if (std::isnan(sampleDifference))
+                    return std::numeric_limits<float>::infinity();
+                difference = std::max(difference, sampleDifference);
+            }
+        return difference;
+    }
+}
@@ -0,0 +1,76 @@
+/*
+  ==============================================================================
+
+    Command line entry point of the test and benchmark suite.
+
+    UltiknobTests [--bench] [--golden <folder>] [--update-golden]
+
+    --bench           runs the benchmarks instead of the tests
+    --golden          folder of the golden renders, by default the
+                      Tests/Golden folder found above the executable
+    --update-golden   records the golden renders from this build,
+                      only after a change to the sound was intended
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "Tests.h"
+#include <iostream>
+
+namespace tests
+{
+    Options& getOptions()
+    {
+        static Options options;
+        return options;
+    }
+}
+
+namespace
+{
+    juce::File findGoldenFolder()
+    {
+        for (auto folder = juce::File::getSpecialLocation(juce::File::currentExecutableFile).getParentDirectory();
+             !folder.isRoot();
+             folder = folder.getParentDirectory())
+        {
+            const auto candidate = folder.getChildFile("Tests").getChildFile("Golden");
+            if (candidate.isDirectory())
+                return candidate;
+        }
+        return {};
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser; // the processor's parameter tree needs a message manager
+
+    juce::ArgumentList args(argc, argv);
+
+    auto& options = tests::getOptions();
+    options.goldenFolder = args.containsOption("--golden")
+        ? args.getFileForOption("--golden")
+        : findGoldenFolder();
+    options.shouldUpdateGolden = args.containsOption("--update-golden");
+
+    const auto isBenchmarking = args.containsOption("--bench");
+
+    juce::Array<juce::UnitTest*> selected;
+    for (auto* test : juce::UnitTest::getAllTests())
+        if ((test->getCategory() == tests::benchmarkCategory) == isBenchmarking)
+            selected.add(test);
+
+    juce::UnitTestRunner runner;
+    runner.setAssertOnFailure(false);
+    runner.runTests(selected);
+
+    auto numFailures = 0;
+    for (auto index = 0; index < runner.getNumResults(); ++index)
+        numFailures += runner.getResult(index)->failures;
+
+    std::cout << (numFailures == 0 ? "all passed" : juce::String(numFailures) + " failed") << std::endl;
+    return numFailures == 0 ? 0 : 1;
+}